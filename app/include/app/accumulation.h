@@ -0,0 +1,129 @@
+#ifndef ACCUMULATION_H
+#define ACCUMULATION_H
+
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "color.h"
+#include "app/canvas.h"
+#include "app/canvas_buffer.h"
+
+namespace Sampling
+{
+  // Offset of sample i inside its pixel, from the R2 sequence: evenly
+  // spread for any sample count, and sample 0 is the pixel center.
+  inline std::pair<float, float> SampleOffset(int i)
+  {
+    double u = 0.5 + i * 0.7548776662466927;
+    double v = 0.5 + i * 0.5698402909980532;
+    return {static_cast<float>(u - std::floor(u)), static_cast<float>(v - std::floor(v))};
+  }
+} // End Sampling
+
+// Running per-pixel sums and sample counts for progressive, multi-sample
+// rendering. Sums are kept in double whatever the canvas type, so a pixel
+// can take millions of samples without the small ones being rounded away.
+//
+// addSample() is safe from any number of threads, and resolve() can run
+// while they keep adding: a pixel resolved in the middle of an add may mix
+// the old count with the new sum (or vice versa), which only shows as noise
+// in a preview that the next resolve corrects.
+template <typename T>
+requires std::floating_point<T>
+class AccumulationBuffer
+{
+public:
+  AccumulationBuffer(int w, int h)
+      : sums_(3 * static_cast<std::size_t>(w) * h), counts_(static_cast<std::size_t>(w) * h), w_{w}, h_{h}
+  {
+    assert(w >= 0);
+    assert(h >= 0);
+  }
+
+  int width() const { return w_; }
+  int height() const { return h_; }
+
+  void addSample(const Color::Color<T> &c, int x, int y)
+  {
+    auto idx = PixelIndex(x, y);
+    std::atomic_ref<double>(sums_[3 * idx]).fetch_add(c.r(), std::memory_order_relaxed);
+    std::atomic_ref<double>(sums_[3 * idx + 1]).fetch_add(c.g(), std::memory_order_relaxed);
+    std::atomic_ref<double>(sums_[3 * idx + 2]).fetch_add(c.b(), std::memory_order_relaxed);
+    std::atomic_ref<uint32_t>(counts_[idx]).fetch_add(1, std::memory_order_relaxed);
+  }
+
+  uint32_t samples(int x, int y) const
+  {
+    return Load(counts_[PixelIndex(x, y)]);
+  }
+
+  // Mean of the samples so far, black for pixels without any.
+  Color::Color<T> pixelAt(int x, int y) const
+  {
+    auto idx = PixelIndex(x, y);
+    auto n = Load(counts_[idx]);
+    if (n == 0)
+      return Color::Color<T>(0, 0, 0);
+    auto r = Load(sums_[3 * idx]);
+    auto g = Load(sums_[3 * idx + 1]);
+    auto b = Load(sums_[3 * idx + 2]);
+    return Color::Color<T>(static_cast<T>(r / n), static_cast<T>(g / n), static_cast<T>(b / n));
+  }
+
+  // Writes the current means of rows [y0, y1) into `out`, so several
+  // threads can resolve bands of one frame.
+  template <typename Layout>
+  void resolve(Canvas<T, Layout> &out, int y0, int y1) const
+  {
+    assert(out.width() == w_);
+    assert(out.height() == h_);
+    for (int y = y0; y < y1; y++)
+    {
+      for (int x = 0; x < w_; x++)
+      {
+        out.writePixel(pixelAt(x, y), x, y);
+      }
+    }
+  }
+
+  template <typename Layout>
+  void resolve(Canvas<T, Layout> &out) const
+  {
+    resolve(out, 0, h_);
+  }
+
+  // Drops every sample, e.g. when the camera moves. Not safe against
+  // concurrent addSample().
+  void clear()
+  {
+    sums_.clear();
+    counts_.clear();
+  }
+
+private:
+  // Relaxed load of a value other threads may be adding to
+  template <typename U>
+  static U Load(const U &v)
+  {
+    return std::atomic_ref<U>(const_cast<U &>(v)).load(std::memory_order_relaxed);
+  }
+
+  std::size_t PixelIndex(int x, int y) const
+  {
+    assert(x >= 0);
+    assert(x < w_);
+    assert(y >= 0);
+    assert(y < h_);
+    return static_cast<std::size_t>(y) * w_ + x;
+  }
+
+  CanvasBuffer<double> sums_;
+  CanvasBuffer<uint32_t> counts_;
+  int w_, h_;
+};
+
+#endif // ACCUMULATION_H
@@ -0,0 +1,91 @@
+#ifndef ADAPTIVE_RESOLUTION_H
+#define ADAPTIVE_RESOLUTION_H
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+
+// Picks the preview resolution for an interactive render. While the input
+// keeps changing every frame, each new image starts at the finest of 1/8,
+// 1/4, 1/2 and full resolution whose whole pass is predicted to fit in one
+// frame at the target rate. Once the input settles, every finished pass is
+// followed by one at twice the resolution until full resolution is reached.
+//
+// Predictions come from the measured shading throughput, so an expensive
+// scene drops to coarse levels on its own and a cheap one stays sharp.
+// Until the first measurement the coarsest level is used.
+class AdaptiveResolution
+{
+public:
+  static constexpr std::array<int, 4> kScales{8, 4, 2, 1};
+
+  // `threads` shading in parallel turn worker seconds into wall time
+  AdaptiveResolution(int w, int h, double targetFps = 30.0, unsigned threads = 1)
+      : pixels_{static_cast<double>(w) * h}, frameSeconds_{1.0 / targetFps}, threads_{threads == 0 ? 1 : threads}
+  {
+    assert(targetFps > 0);
+  }
+
+  // Shading work done since the last call: `samples` shaded taking
+  // `seconds` of worker time in total.
+  void measured(std::size_t samples, double seconds)
+  {
+    if (samples == 0 || seconds <= 0)
+      return;
+    auto cost = seconds / samples;
+    // Smoothed, one slow tile shouldn't throw the preview to 1/8
+    secondsPerSample_ = secondsPerSample_ == 0 ? cost : 0.8 * secondsPerSample_ + 0.2 * cost;
+  }
+
+  // Wall time a pass at 1/scale resolution is expected to take, 0 when
+  // nothing has been measured yet.
+  double predictedSeconds(int scale) const
+  {
+    return pixels_ / (static_cast<double>(scale) * scale) * secondsPerSample_ / threads_;
+  }
+
+  // The input changed: the scale to start the new image at.
+  int restart()
+  {
+    scale_ = kScales.front();
+    if (secondsPerSample_ > 0)
+    {
+      for (auto s : kScales)
+      {
+        if (predictedSeconds(s) <= frameSeconds_)
+          scale_ = s;
+      }
+    }
+    return scale_;
+  }
+
+  // The current pass finished and the input is unchanged: the scale of the
+  // next refinement pass, or 0 when the image is already at full resolution.
+  int refine()
+  {
+    if (scale_ <= 1)
+      return 0;
+    scale_ /= 2;
+    return scale_;
+  }
+
+  // Scale of the pass in progress
+  int scale() const { return scale_; }
+
+  double targetFps() const { return 1.0 / frameSeconds_; }
+
+  void setTargetFps(double fps)
+  {
+    assert(fps > 0);
+    frameSeconds_ = 1.0 / fps;
+  }
+
+private:
+  double pixels_;
+  double frameSeconds_;
+  unsigned threads_;
+  double secondsPerSample_ = 0;
+  int scale_ = kScales.front();
+};
+
+#endif // ADAPTIVE_RESOLUTION_H
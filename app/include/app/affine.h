@@ -0,0 +1,190 @@
+#ifndef AFFINE_H
+#define AFFINE_H
+
+#include <array>
+#include <cassert>
+
+#include "types.h"
+#include "math.h"
+#include "app/matrix.h"
+#include "app/tuple.h"
+
+namespace Matrix
+{
+  // 4x4 transform with an implied bottom row of 0 0 0 1, stored as its 3x3
+  // linear part plus a translation. Composes in 36 multiplies instead of 64
+  // and inverts through a 3x3 inverse and a back-substituted translation.
+  //
+  // Like Transform, the normal matrix is cached on first access from a
+  // const method; call inverse_transpose() once before sharing a transform
+  // between threads.
+  template <class T>
+  requires Number<T>
+  class AffineTransform
+  {
+    Matrix3<T> linear_;
+    std::array<T, 3> translation_{};
+    mutable Matrix3<T> normal_;
+    mutable bool normal_cached_ = false;
+
+  public:
+    AffineTransform() : linear_{Identity<T, 3>()} {};
+
+    AffineTransform(const Matrix3<T> &linear, const std::array<T, 3> &translation)
+        : linear_{linear}, translation_{translation} {};
+
+    explicit AffineTransform(const Matrix4<T> &m)
+    {
+      assert(epsilon_eq(m(3, 0), 0) && epsilon_eq(m(3, 1), 0) && epsilon_eq(m(3, 2), 0));
+      assert(epsilon_eq(m(3, 3), 1));
+      for (uint_fast32_t x = 0; x < 3; x++)
+      {
+        for (uint_fast32_t y = 0; y < 3; y++)
+        {
+          linear_(x, y) = m(x, y);
+        }
+        translation_[x] = m(x, 3);
+      }
+    }
+
+    const Matrix3<T> &linear() const { return linear_; }
+    const std::array<T, 3> &translation() const { return translation_; }
+
+    Matrix4<T> matrix() const
+    {
+      auto res = Identity<T>();
+      for (uint_fast32_t x = 0; x < 3; x++)
+      {
+        for (uint_fast32_t y = 0; y < 3; y++)
+        {
+          res(x, y) = linear_(x, y);
+        }
+        res(x, 3) = translation_[x];
+      }
+      return res;
+    }
+
+    operator Matrix4<T>() const
+    {
+      return matrix();
+    }
+
+    bool operator==(const AffineTransform<T> &rhs) const
+    {
+      return linear_ == rhs.linear_ &&
+             epsilon_eq(translation_[0], rhs.translation_[0]) &&
+             epsilon_eq(translation_[1], rhs.translation_[1]) &&
+             epsilon_eq(translation_[2], rhs.translation_[2]);
+    }
+
+    AffineTransform<T> operator*(const AffineTransform<T> &rhs) const
+    {
+      auto res = AffineTransform<T>(linear_ * rhs.linear_, translation_);
+      for (uint_fast32_t x = 0; x < 3; x++)
+      {
+        for (uint_fast32_t i = 0; i < 3; i++)
+        {
+          res.translation_[x] += linear_(x, i) * rhs.translation_[i];
+        }
+      }
+      return res;
+    }
+
+    Tuple::Tuple<T> operator*(const Tuple::Tuple<T> &rhs) const
+    {
+      const auto &l = linear_;
+      const auto &t = translation_;
+      return Tuple::Tuple<T>(l(0, 0) * rhs.x() + l(0, 1) * rhs.y() + l(0, 2) * rhs.z() + t[0] * rhs.w(),
+                             l(1, 0) * rhs.x() + l(1, 1) * rhs.y() + l(1, 2) * rhs.z() + t[1] * rhs.w(),
+                             l(2, 0) * rhs.x() + l(2, 1) * rhs.y() + l(2, 2) * rhs.z() + t[2] * rhs.w(),
+                             rhs.w());
+    }
+
+    bool invertible() const
+    {
+      return linear_.invertible();
+    }
+
+    AffineTransform<T> inverse() const
+    {
+      auto res = AffineTransform<T>(linear_.inverse(), {});
+      // The inverse's normal matrix is our own linear part transposed
+      res.normal_ = linear_.t();
+      res.normal_cached_ = true;
+      for (uint_fast32_t x = 0; x < 3; x++)
+      {
+        for (uint_fast32_t i = 0; i < 3; i++)
+        {
+          res.translation_[x] -= res.linear_(x, i) * translation_[i];
+        }
+      }
+      return res;
+    }
+
+    // Normal matrix: translation never affects normals, so this is only the
+    // transposed inverse of the linear part. Computed on first use and kept,
+    // translate() carries it over.
+    const Matrix3<T> &inverse_transpose() const
+    {
+      if (!normal_cached_)
+      {
+        normal_ = linear_.inverse().t();
+        normal_cached_ = true;
+      }
+      return normal_;
+    }
+
+    bool normal_cached() const
+    {
+      return normal_cached_;
+    }
+
+    AffineTransform<T> translate(T x, T y, T z) const
+    {
+      auto res = *this;
+      res.translation_[0] += x;
+      res.translation_[1] += y;
+      res.translation_[2] += z;
+      return res;
+    }
+
+    AffineTransform<T> scale(T x, T y, T z) const
+    {
+      return AffineTransform<T>(Scaling(x, y, z)) * *this;
+    }
+
+    AffineTransform<T> rotate_x(T rads) const
+    {
+      return AffineTransform<T>(RotationX(rads)) * *this;
+    }
+
+    AffineTransform<T> rotate_y(T rads) const
+    {
+      return AffineTransform<T>(RotationY(rads)) * *this;
+    }
+
+    AffineTransform<T> rotate_z(T rads) const
+    {
+      return AffineTransform<T>(RotationZ(rads)) * *this;
+    }
+
+    AffineTransform<T> shear(T xy, T xz, T yx, T yz, T zx, T zy) const
+    {
+      return AffineTransform<T>(Shearing(xy, xz, yx, yz, zx, zy)) * *this;
+    }
+  };
+
+  // Transforms a normal by a normal matrix (see inverse_transpose()).
+  // The result is not normalized.
+  template <class T>
+  requires Number<T>
+  Tuple::Tuple<T> TransformNormal(const Matrix3<T> &normal_matrix, const Tuple::Tuple<T> &n)
+  {
+    const auto &m = normal_matrix;
+    return Tuple::Vector(m(0, 0) * n.x() + m(0, 1) * n.y() + m(0, 2) * n.z(),
+                         m(1, 0) * n.x() + m(1, 1) * n.y() + m(1, 2) * n.z(),
+                         m(2, 0) * n.x() + m(2, 1) * n.y() + m(2, 2) * n.z());
+  }
+} // End Matrix
+
+#endif // AFFINE_H
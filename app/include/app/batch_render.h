@@ -0,0 +1,78 @@
+#ifndef BATCH_RENDER_H
+#define BATCH_RENDER_H
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+
+#include "color.h"
+#include "app/accumulation.h"
+#include "app/canvas.h"
+#include "app/parallel.h"
+#include "app/profiler.h"
+
+struct BatchOptions
+{
+  int width = 500;
+  int height = 500;
+  // 0 means one per hardware thread
+  unsigned threads = 0;
+  // Per pixel, averaged
+  int samples = 1;
+  // Seconds after which no more samples are started, 0 for no limit.
+  // Checked after each pass of one sample per pixel, so every pixel ends
+  // up with the same count and the first pass always completes.
+  double timeBudget = 0;
+};
+
+struct BatchResult
+{
+  Canvas<float> canvas;
+  // Per pixel, fewer than asked for if the time budget ran out
+  int samples = 0;
+};
+
+// Renders a whole image without any UI. Samples are added to an
+// AccumulationBuffer one pass over the image at a time, rows handed out to
+// the threads one at a time. `shade(u, v)` gets continuous pixel
+// coordinates and is called from every thread at once.
+template <typename Shade>
+BatchResult RenderBatch(const BatchOptions &opts, Shade shade)
+{
+  assert(opts.samples > 0);
+  assert(opts.timeBudget >= 0);
+  RTC_PROFILE_SCOPE("RenderBatch");
+  auto begin = std::chrono::steady_clock::now();
+  auto threads = Parallel::ResolveThreads(opts.threads);
+  auto acc = AccumulationBuffer<float>(opts.width, opts.height);
+  auto res = BatchResult{Canvas<float>(opts.width, opts.height), 0};
+
+  // Runs row(y) for every row on all threads
+  auto forRows = [&](auto row)
+  {
+    auto next = std::atomic<int>(0);
+    auto workers = Parallel::WorkerGroup(threads, [&]()
+                                         {
+      for (int y = next.fetch_add(1, std::memory_order_relaxed); y < opts.height; y = next.fetch_add(1, std::memory_order_relaxed))
+        row(y); });
+    workers.join();
+  };
+
+  while (res.samples < opts.samples)
+  {
+    auto offset = Sampling::SampleOffset(res.samples);
+    forRows([&](int y)
+            {
+      for (int x = 0; x < opts.width; x++)
+        acc.addSample(shade(x + offset.first, y + offset.second), x, y); });
+    res.samples++;
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    if (opts.timeBudget > 0 && elapsed >= opts.timeBudget)
+      break;
+  }
+  forRows([&](int y)
+          { acc.resolve(res.canvas, y, y + 1); });
+  return res;
+}
+
+#endif // BATCH_RENDER_H
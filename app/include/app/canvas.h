@@ -2,112 +2,459 @@
 #define CANVAS_H
 
 #include <cassert>
-#include <mutex>
-#include <shared_mutex>
 #include <fmt/core.h>
-#include <fstream>
 #include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
 
 #include "color.h"
+#include "app/canvas_buffer.h"
+#include "app/canvas_layout.h"
+#include "app/dirty_tiles.h"
+#include "app/file_io.h"
+#include "app/ppm.h"
+#include "app/ppm_reader.h"
+#include "app/profiler.h"
+#include "app/qoi.h"
 
-template <typename T>
+enum class ImageFormat
+{
+  PPM_P3,
+  PPM_P6,
+  QOI
+};
+
+// Picks the format from the end of the file name, ignoring case: ".qoi"
+// selects QOI, ".p6.ppm" binary PPM and anything else the ASCII PPM
+// writeFile always produced.
+inline ImageFormat ImageFormatFor(const std::string &filename)
+{
+  auto endsWith = [&](std::string_view ext)
+  {
+    if (filename.size() < ext.size())
+      return false;
+    return std::equal(ext.begin(), ext.end(), filename.end() - ext.size(), [](char a, char b)
+                      { return a == std::tolower(static_cast<unsigned char>(b)); });
+  };
+  if (endsWith(".qoi"))
+    return ImageFormat::QOI;
+  if (endsWith(".p6.ppm"))
+    return ImageFormat::PPM_P6;
+  return ImageFormat::PPM_P3;
+}
+
+inline std::string MakePPMHeader(ImageFormat format, int w, int h)
+{
+  assert(format != ImageFormat::QOI);
+  std::string out;
+  out.append(format == ImageFormat::PPM_P6 ? "P6\n" : "P3\n");
+  out.append(fmt::format("{} {}\n", w, h));
+  out.append("255\n");
+  return out;
+}
+
+// Keeps a canvas in a memory-mapped file instead of memory, see the
+// matching Canvas constructor.
+struct FileBacking
+{
+  std::string path;
+};
+
+// Leads the components in a file-backed canvas, a whole cache line so the
+// components stay 64-byte aligned.
+struct alignas(64) CanvasFileHeader
+{
+  char magic[8];
+  uint32_t width;
+  uint32_t height;
+  uint32_t componentSize;
+  uint32_t layout;
+  uint32_t tileWidth;
+  uint32_t tileHeight;
+  uint64_t progress;
+};
+
+template <typename T, typename Layout>
+requires std::floating_point<T>
+class CanvasPool;
+
+// `Layout` picks the storage order (see canvas_layout.h). Pixel access is
+// the same for every layout, only data() exposes the raw order.
+//
+// Concurrent writes take no locks:
+// - writePixel() needs no synchronization as long as every pixel is
+//   written by one thread, e.g. each render thread owning whole tiles.
+//   With a tiled layout and tiles that are multiples of the layout's tile
+//   size, threads also never false-share a cache line.
+// - addSample() may hit the same pixel from any number of threads, for
+//   splatting. Each component is a relaxed atomic add.
+// Readers (pixelAt, the writers, copyRow) see a consistent image once the
+// writing threads have been joined or otherwise synchronized with.
+template <typename T, typename Layout = CanvasLayout::RowMajor>
 requires std::floating_point<T>
 class Canvas
 {
 public:
-  Canvas(int w, int h)
+  using layout_type = Layout;
+
+  Canvas(int w, int h, PageSize pages = PageSize::Default)
+      : data_(Layout::Components(w, h), pages), dirty_(w, h), w_{w}, h_{h}
   {
     assert(w >= 0);
     assert(h >= 0);
-    w_ = w;
-    h_ = h;
-    T color_component = static_cast<T>(0.0);
-    auto color = Color::Color<T>(color_component, color_component, color_component);
-    data_ = (T *)calloc(sizeof(color), w_ * h_);
   }
+
+  // Canvas stored in a memory-mapped file, for renders larger than RAM:
+  // the kernel pages tiles in and out as they are touched. A new file is
+  // created sparse, so only written pages take disk space. An existing one
+  // with the same size, component type and layout is reopened with its
+  // contents, to resume a render after a crash; anything else throws.
+  // The file is sized for w x h once and never grows: a canvas of other
+  // dimensions needs a new file.
+  Canvas(int w, int h, const FileBacking &file) : Canvas(MapFile(w, h, file.path), w, h) {}
+
+  // Loads a P3 or P6 image, parsed straight from the mapped file into the
+  // canvas buffer. Components are scaled back to [0, 1].
+  explicit Canvas(const std::string &filename) : Canvas(MappedFile(filename)) {}
+
+  explicit Canvas(const MappedFile &file) : Canvas(file, ReadHeader(file)) {}
+
+  // Copies are deep, a moved-from canvas is empty (0 x 0).
+  Canvas(const Canvas &rhs) : data_{rhs.data_.clone()}, dirty_{rhs.dirty_}, w_{rhs.w_}, h_{rhs.h_} {}
+
+  Canvas(Canvas &&rhs) noexcept
+      : data_{std::move(rhs.data_)}, dirty_{std::move(rhs.dirty_)},
+        w_{std::exchange(rhs.w_, 0)}, h_{std::exchange(rhs.h_, 0)}
+  {
+  }
+
+  Canvas &operator=(const Canvas &rhs)
+  {
+    if (this != &rhs)
+      *this = Canvas(rhs);
+    return *this;
+  }
+
+  Canvas &operator=(Canvas &&rhs) noexcept
+  {
+    data_ = std::move(rhs.data_);
+    dirty_ = std::move(rhs.dirty_);
+    w_ = std::exchange(rhs.w_, 0);
+    h_ = std::exchange(rhs.h_, 0);
+    return *this;
+  }
+
   ~Canvas() = default;
 
-  int width() { return w_; };
-  int height() { return h_; };
+  int width() const { return w_; };
+  int height() const { return h_; };
 
   void writePixel(Color::Color<T> c, int x, int y)
   {
     auto idx = PixelIndex(x, y);
     memcpy(&data_[idx], &c, sizeof(c));
+    dirty_.mark(x, y);
   }
 
-  Color::Color<T> pixelAt(int w, int h)
+  // Adds `c` to the pixel, safe against concurrent addSample() calls on
+  // the same pixel. Contention is per pixel, there is no shared lock.
+  void addSample(Color::Color<T> c, int x, int y)
+  {
+    auto idx = PixelIndex(x, y);
+    std::atomic_ref<T>(data_[idx]).fetch_add(c.r(), std::memory_order_relaxed);
+    std::atomic_ref<T>(data_[idx + 1]).fetch_add(c.g(), std::memory_order_relaxed);
+    std::atomic_ref<T>(data_[idx + 2]).fetch_add(c.b(), std::memory_order_relaxed);
+    dirty_.mark(x, y);
+  }
+
+  Color::Color<T> pixelAt(int w, int h) const
   {
     auto idx = PixelIndex(w, h);
     auto res = Color::Color<T>();
     memcpy(&res, &data_[idx], sizeof(res));
-    return std::move(res);
+    return res;
   }
 
+  // Raw components in the layout's order, r, g, b triplets row after row
+  // for the default RowMajor. Writes through it aren't tracked, follow them
+  // with markDirty().
   T *data()
   {
-    return data_;
+    return data_.data();
   }
 
-  void writeFile(std::string filename)
+  const T *data() const
   {
-    std::ofstream out(filename, std::ofstream::out);
-    writeStream(out);
-    out.close();
+    return data_.data();
+  }
+
+  // Components of row y in row-major order, 3 * width() values.
+  void copyRow(int y, T *out) const
+  {
+    assert(y >= 0);
+    assert(y < h_);
+    Layout::CopyRow(data_.data(), w_, y, out);
+  }
+
+  // The whole image in row-major order, 3 * width() * height() values, e.g.
+  // a staging buffer for a GL upload.
+  void toRowMajor(T *out) const
+  {
+    for (int y = 0; y < h_; y++)
+      copyRow(y, out + 3 * static_cast<std::size_t>(y) * w_);
+  }
+
+  void fromRowMajor(const T *in)
+  {
+    for (int y = 0; y < h_; y++)
+      Layout::StoreRow(data_.data(), w_, y, in + 3 * static_cast<std::size_t>(y) * w_);
+    dirty_.markAll();
   }
 
-  std::string mkPPMHeader()
+  // Components of the rectangle in row-major order, 3 * r.w * r.h values.
+  void copyRect(const DirtyRect &r, T *out) const
   {
-    std::string out;
-    out.append("P3\n");
-    out.append(fmt::format("{} {}\n", width(), height()));
-    out.append("255\n");
-    return out;
+    assert(r.x >= 0 && r.y >= 0 && r.x + r.w <= w_ && r.y + r.h <= h_);
+    for (int y = r.y; y < r.y + r.h; y++)
+    {
+      if constexpr (Layout::kRowMajor)
+      {
+        std::memcpy(out, data_.data() + Layout::Index(r.x, y, w_), 3 * r.w * sizeof(T));
+        out += 3 * r.w;
+      }
+      else
+      {
+        for (int x = r.x; x < r.x + r.w; x++, out += 3)
+          std::memcpy(out, data_.data() + Layout::Index(x, y, w_), 3 * sizeof(T));
+      }
+    }
   }
 
-  std::string mkPPMPayload()
+  // The reverse of copyRect(), e.g. for tiles rendered elsewhere. Marks
+  // the rectangle dirty.
+  void storeRect(const DirtyRect &r, const T *in)
   {
-    auto w = width();
-    auto h = height();
-    std::string out;
-    for (auto j = 0; j < h; j++)
+    assert(r.x >= 0 && r.y >= 0 && r.x + r.w <= w_ && r.y + r.h <= h_);
+    for (int y = r.y; y < r.y + r.h; y++)
     {
-      for (auto i = 0; i < w; i++)
+      if constexpr (Layout::kRowMajor)
       {
-        auto c = pixelAt(i, j);
-        auto r = std::clamp((int)std::ceil(c.r() * 255), 0, 255);
-        auto g = std::clamp((int)std::ceil(c.g() * 255), 0, 255);
-        auto b = std::clamp((int)std::ceil(c.b() * 255), 0, 255);
-        out.append(fmt::format("{} {} {}", r, g, b));
-        if (i + 1 < w)
-          out.append(" ");
+        std::memcpy(data_.data() + Layout::Index(r.x, y, w_), in, 3 * r.w * sizeof(T));
+        in += 3 * r.w;
+      }
+      else
+      {
+        for (int x = r.x; x < r.x + r.w; x++, in += 3)
+          std::memcpy(data_.data() + Layout::Index(x, y, w_), in, 3 * sizeof(T));
       }
-      out.append("\n");
     }
-    out.append("\n");
-    return out;
+    dirty_.mark(r.x, r.y, r.w, r.h);
+  }
+
+  // Dirty-rectangle tracking for the preview: every write marks the
+  // DirtyTiles::kTileSize tile it lands in, takeDirtyRects() hands out the
+  // areas written since the last call. A new canvas is entirely dirty.
+  void markDirty(int x, int y, int w, int h)
+  {
+    dirty_.mark(x, y, w, h);
+  }
+
+  std::vector<DirtyRect> takeDirtyRects()
+  {
+    return dirty_.take();
+  }
+
+  // File-backed canvases only: flushes every written page to disk along
+  // with `progress`, an opaque value for the renderer to resume from (e.g.
+  // the next tile to render).
+  void checkpoint(uint64_t progress)
+  {
+    auto region = data_.region();
+    if (!region)
+      throw std::logic_error("checkpoint() needs a file-backed canvas");
+    reinterpret_cast<CanvasFileHeader *>(region->data())->progress = progress;
+    region->sync();
+  }
+
+  // The progress of the last checkpoint(), 0 for a new file
+  uint64_t checkpointedProgress() const
+  {
+    auto region = data_.region();
+    return region ? reinterpret_cast<const CanvasFileHeader *>(region->data())->progress : 0;
+  }
+
+  bool fileBacked() const
+  {
+    return data_.region() != nullptr;
+  }
+
+  // Streams the image out a band of rows at a time, the payload is never
+  // held in memory as a whole. PPM bands are encoded on `threads` threads
+  // (0 for all cores), QOI is inherently sequential and always uses one.
+  void writeFile(std::string filename)
+  {
+    writeFile(filename, ImageFormatFor(filename));
+  }
+
+  void writeFile(std::string filename, ImageFormat format, unsigned threads = 0)
+  {
+    RTC_PROFILE_SCOPE("Canvas::writeFile");
+    auto out = FileWriter(filename);
+    writeStream(out, format, threads);
+    out.close();
+  }
+
+  std::string mkPPMHeader(ImageFormat format = ImageFormat::PPM_P3)
+  {
+    return MakePPMHeader(format, w_, h_);
+  }
+
+  std::string mkPPMPayload(unsigned threads = 0)
+  {
+    struct Appender
+    {
+      std::string &s;
+      void write(std::string_view text) { s.append(text); }
+    };
+    std::string res;
+    auto out = Appender{res};
+    PPM::WriteP3PayloadParallel<T>(out, w_, h_, rows(), threads);
+    return res;
   }
 
 private:
+  friend class CanvasPool<T, Layout>;
+
+  Canvas(CanvasBuffer<T> &&buffer, int w, int h) : Canvas(std::move(buffer), DirtyTiles(w, h), w, h) {}
+
+  // Takes over recycled storage, flags included, so a pooled canvas
+  // allocates nothing
+  Canvas(CanvasBuffer<T> &&buffer, DirtyTiles &&dirty, int w, int h)
+      : data_{std::move(buffer)}, dirty_{std::move(dirty)}, w_{w}, h_{h}
+  {
+    assert(data_.size() == Layout::Components(w, h));
+    assert(dirty_.width() == w && dirty_.height() == h);
+  }
+
+  Canvas(const MappedFile &file, std::pair<PPM::Header, const char *> header)
+      : Canvas(header.first.width, header.first.height)
+  {
+    auto end = file.data() + file.size();
+    if constexpr (Layout::kRowMajor)
+    {
+      PPM::DecodePayload(header.second, end, header.first, data_.data());
+    }
+    else
+    {
+      auto rgb = std::vector<T>(3 * static_cast<std::size_t>(w_) * h_);
+      PPM::DecodePayload(header.second, end, header.first, rgb.data());
+      fromRowMajor(rgb.data());
+    }
+  }
+
+  static CanvasBuffer<T> MapFile(int w, int h, const std::string &path)
+  {
+    assert(w >= 0);
+    assert(h >= 0);
+    auto size = Layout::Components(w, h);
+    auto region = std::make_unique<MappedRegion>(path, sizeof(CanvasFileHeader) + size * sizeof(T));
+    auto expected = CanvasFileHeader{{'R', 'T', 'C', 'C', 'A', 'N', 'V', '1'},
+                                     static_cast<uint32_t>(w),
+                                     static_cast<uint32_t>(h),
+                                     sizeof(T),
+                                     Layout::kId,
+                                     Layout::kTileWidth,
+                                     Layout::kTileHeight,
+                                     0};
+    auto header = reinterpret_cast<CanvasFileHeader *>(region->data());
+    if (region->created())
+    {
+      *header = expected;
+    }
+    else if (std::memcmp(header->magic, expected.magic, sizeof(expected.magic)) != 0 ||
+             header->width != expected.width || header->height != expected.height ||
+             header->componentSize != expected.componentSize || header->layout != expected.layout ||
+             header->tileWidth != expected.tileWidth || header->tileHeight != expected.tileHeight)
+    {
+      throw std::runtime_error(path + " holds a different canvas");
+    }
+    return CanvasBuffer<T>(std::move(region), sizeof(CanvasFileHeader), size);
+  }
+
+  // The header and where the payload starts, checked against the file size
+  // before the constructor allocates what the header asks for
+  static std::pair<PPM::Header, const char *> ReadHeader(const MappedFile &file)
+  {
+    auto in = PPM::MemoryReader{file.data(), file.data() + file.size()};
+    auto header = PPM::ReadHeader(in);
+    PPM::CheckPayloadSize(header, static_cast<std::size_t>(file.data() + file.size() - in.p));
+    return {header, in.p};
+  }
+
   // Canvas data in GL_FLOAT or GL_DOUBLE format (r, g, b triplets).
-  T *data_;
-  mutable std::mutex MXdata_;
+  CanvasBuffer<T> data_;
+  DirtyTiles dirty_;
 
   int w_, h_;
-  int PixelIndex(int x, int y)
+  std::size_t PixelIndex(int x, int y) const
   {
     assert(x >= 0);
     assert(x < w_);
     assert(y >= 0);
     assert(y < h_);
 
-    return 3 * (x + y * w_);
+    return Layout::Index(x, y, w_);
   }
 
-  void writeStream(std::ostream &stream)
+  // Row source for the encoders, `rows()(y)` returns the r, g, b components
+  // of row y. Other layouts gather the row into a per-thread scratch
+  // buffer, valid until that thread asks for the next row.
+  auto rows() const
   {
-    stream << mkPPMHeader();
-    stream << mkPPMPayload();
+    if constexpr (Layout::kRowMajor)
+    {
+      return [this](int y)
+      {
+        assert(y >= 0);
+        assert(y < h_);
+        return static_cast<const T *>(data_.data() + Layout::Index(0, y, w_));
+      };
+    }
+    else
+    {
+      return [this](int y)
+      {
+        thread_local std::vector<T> scratch;
+        scratch.resize(3 * static_cast<std::size_t>(w_));
+        copyRow(y, scratch.data());
+        return static_cast<const T *>(scratch.data());
+      };
+    }
+  }
+
+  void writeStream(FileWriter &out, ImageFormat format, unsigned threads)
+  {
+    auto rows = this->rows();
+    switch (format)
+    {
+    case ImageFormat::PPM_P3:
+      out.write(mkPPMHeader(format));
+      PPM::WriteP3PayloadParallel<T>(out, w_, h_, rows, threads);
+      break;
+    case ImageFormat::PPM_P6:
+      out.write(mkPPMHeader(format));
+      // Parallel bands go to fixed offsets, a pipe has to take them in order
+      PPM::WriteP6PayloadParallel<T>(out, w_, h_, rows, out.seekable() ? threads : 1);
+      break;
+    case ImageFormat::QOI:
+      QOI::Write<T>(out, w_, h_, rows);
+      break;
+    }
   }
 };
 
@@ -0,0 +1,168 @@
+#ifndef CANVAS_BUFFER_H
+#define CANVAS_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "app/file_io.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+enum class PageSize
+{
+  Default,
+  // Transparent huge pages where the OS allows them, for large canvases
+  // that would otherwise take a TLB miss every few rows
+  Huge
+};
+
+// Bytes held by every CanvasBuffer in the process, for the performance
+// panel. Counted per allocation, not per pixel access.
+namespace CanvasMemory
+{
+  inline std::atomic<std::size_t> heapBytes{0};
+  inline std::atomic<std::size_t> mappedBytes{0};
+  inline std::atomic<std::size_t> heapAllocations{0};
+
+  inline std::size_t HeapBytes() { return heapBytes.load(std::memory_order_relaxed); }
+  inline std::size_t MappedBytes() { return mappedBytes.load(std::memory_order_relaxed); }
+  // Heap buffers allocated since startup, freed ones included
+  inline std::size_t HeapAllocations() { return heapAllocations.load(std::memory_order_relaxed); }
+} // End CanvasMemory
+
+// Zero-initialized, 64-byte aligned storage for canvas components, so rows
+// start on a cache line and SIMD loads never straddle one. Owning and
+// move-only, copies are explicit through clone(). Either heap memory or a
+// range of a MappedRegion, for canvases larger than RAM.
+template <typename T>
+class CanvasBuffer
+{
+public:
+  static constexpr std::size_t kAlignment = 64;
+  static constexpr std::size_t kHugePageSize = std::size_t(2) << 20;
+
+  CanvasBuffer() = default;
+
+  explicit CanvasBuffer(std::size_t size, PageSize pages = PageSize::Default) : size_{size}, pages_{pages}
+  {
+    if (size_ == 0)
+      return;
+    auto bytes = size_ * sizeof(T);
+    auto alignment = kAlignment;
+    if (pages_ == PageSize::Huge && bytes >= kHugePageSize)
+      alignment = kHugePageSize;
+    // aligned_alloc wants a multiple of the alignment
+    bytes = (bytes + alignment - 1) / alignment * alignment;
+    data_ = static_cast<T *>(std::aligned_alloc(alignment, bytes));
+    if (!data_)
+      throw std::bad_alloc();
+    bytes_ = bytes;
+    CanvasMemory::heapBytes.fetch_add(bytes_, std::memory_order_relaxed);
+    CanvasMemory::heapAllocations.fetch_add(1, std::memory_order_relaxed);
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (alignment == kHugePageSize)
+      ::madvise(data_, bytes, MADV_HUGEPAGE);
+#endif
+    // Also faults every page in now rather than in the middle of a render
+    clear();
+  }
+
+  // Components at `offset` bytes into a file mapping, which the buffer
+  // keeps alive. Contents are whatever the file holds.
+  CanvasBuffer(std::unique_ptr<MappedRegion> region, std::size_t offset, std::size_t size)
+      : data_{reinterpret_cast<T *>(region->data() + offset)}, size_{size}, bytes_{size * sizeof(T)}, region_{std::move(region)}
+  {
+    CanvasMemory::mappedBytes.fetch_add(bytes_, std::memory_order_relaxed);
+  }
+
+  ~CanvasBuffer()
+  {
+    release();
+  }
+
+  CanvasBuffer(const CanvasBuffer &) = delete;
+  CanvasBuffer &operator=(const CanvasBuffer &) = delete;
+
+  CanvasBuffer(CanvasBuffer &&rhs) noexcept
+      : data_{std::exchange(rhs.data_, nullptr)},
+        size_{std::exchange(rhs.size_, 0)},
+        bytes_{std::exchange(rhs.bytes_, 0)},
+        pages_{rhs.pages_},
+        region_{std::move(rhs.region_)}
+  {
+  }
+
+  CanvasBuffer &operator=(CanvasBuffer &&rhs) noexcept
+  {
+    if (this != &rhs)
+    {
+      release();
+      data_ = std::exchange(rhs.data_, nullptr);
+      size_ = std::exchange(rhs.size_, 0);
+      bytes_ = std::exchange(rhs.bytes_, 0);
+      pages_ = rhs.pages_;
+      region_ = std::move(rhs.region_);
+    }
+    return *this;
+  }
+
+  // Copies always live in memory, also those of mapped buffers
+  CanvasBuffer clone() const
+  {
+    auto res = CanvasBuffer(size_, pages_);
+    if (size_ > 0)
+      std::memcpy(res.data_, data_, size_ * sizeof(T));
+    return res;
+  }
+
+  void clear()
+  {
+    if (size_ > 0)
+      std::memset(data_, 0, size_ * sizeof(T));
+  }
+
+  T *data() { return data_; }
+  const T *data() const { return data_; }
+  std::size_t size() const { return size_; }
+  PageSize pages() const { return pages_; }
+
+  // The file mapping behind the buffer, null for heap memory
+  MappedRegion *region() { return region_.get(); }
+  const MappedRegion *region() const { return region_.get(); }
+
+  T &operator[](std::size_t i) { return data_[i]; }
+  const T &operator[](std::size_t i) const { return data_[i]; }
+
+private:
+  void release()
+  {
+    if (!region_)
+    {
+      std::free(data_);
+      CanvasMemory::heapBytes.fetch_sub(bytes_, std::memory_order_relaxed);
+    }
+    else
+    {
+      CanvasMemory::mappedBytes.fetch_sub(bytes_, std::memory_order_relaxed);
+    }
+    region_.reset();
+    data_ = nullptr;
+    bytes_ = 0;
+  }
+
+  T *data_ = nullptr;
+  std::size_t size_ = 0;
+  // As allocated or mapped, for CanvasMemory
+  std::size_t bytes_ = 0;
+  PageSize pages_ = PageSize::Default;
+  std::unique_ptr<MappedRegion> region_;
+};
+
+#endif // CANVAS_BUFFER_H
@@ -0,0 +1,163 @@
+#ifndef CANVAS_LAYOUT_H
+#define CANVAS_LAYOUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Storage orders for Canvas. Every layout keeps a pixel's r, g, b
+// components next to each other and maps (x, y) to the offset of its r
+// component within a buffer of Components(w, h) values.
+//
+// The tiled layouts keep every tile in its own cache lines: a tile holds a
+// multiple of 16 pixels, which is a multiple of 64 bytes for float and
+// double components, and the buffer itself is 64-byte aligned. Render
+// threads that own whole tiles therefore never write to a line another
+// thread touches.
+namespace CanvasLayout
+{
+  // Plain rows, what GL uploads and the image encoders expect.
+  struct RowMajor
+  {
+    // Tells layouts apart in file-backed canvases
+    static constexpr uint32_t kId = 0;
+    static constexpr bool kRowMajor = true;
+    static constexpr int kTileWidth = 1;
+    static constexpr int kTileHeight = 1;
+
+    static std::size_t Components(int w, int h)
+    {
+      return 3 * static_cast<std::size_t>(w) * h;
+    }
+
+    static std::size_t Index(int x, int y, int w)
+    {
+      return 3 * (static_cast<std::size_t>(y) * w + x);
+    }
+
+    template <typename T>
+    static void CopyRow(const T *data, int w, int y, T *out)
+    {
+      std::memcpy(out, data + Index(0, y, w), 3 * w * sizeof(T));
+    }
+
+    template <typename T>
+    static void StoreRow(T *data, int w, int y, const T *in)
+    {
+      std::memcpy(data + Index(0, y, w), in, 3 * w * sizeof(T));
+    }
+  };
+
+  // TW x TH pixel tiles stored one after the other in row-major order,
+  // pixels inside a tile in row-major order. Partial tiles at the right and
+  // bottom edges are padded.
+  template <int TW, int TH>
+  requires(TW > 0 && TH > 0 && TW * TH % 16 == 0)
+  struct Tiled
+  {
+    static constexpr uint32_t kId = 1;
+    static constexpr bool kRowMajor = false;
+    static constexpr int kTileWidth = TW;
+    static constexpr int kTileHeight = TH;
+
+    static std::size_t TilesX(int w)
+    {
+      return (static_cast<std::size_t>(w) + TW - 1) / TW;
+    }
+
+    static std::size_t Components(int w, int h)
+    {
+      return 3 * TilesX(w) * ((static_cast<std::size_t>(h) + TH - 1) / TH) * TW * TH;
+    }
+
+    static std::size_t Index(int x, int y, int w)
+    {
+      auto tile = (y / TH) * TilesX(w) + x / TW;
+      return 3 * (tile * TW * TH + (y % TH) * TW + x % TW);
+    }
+
+    // A row crosses each tile as one contiguous run of TW pixels
+    template <typename T>
+    static void CopyRow(const T *data, int w, int y, T *out)
+    {
+      for (int x = 0; x < w; x += TW)
+      {
+        auto n = (x + TW <= w ? TW : w - x);
+        std::memcpy(out + 3 * x, data + Index(x, y, w), 3 * n * sizeof(T));
+      }
+    }
+
+    template <typename T>
+    static void StoreRow(T *data, int w, int y, const T *in)
+    {
+      for (int x = 0; x < w; x += TW)
+      {
+        auto n = (x + TW <= w ? TW : w - x);
+        std::memcpy(data + Index(x, y, w), in + 3 * x, 3 * n * sizeof(T));
+      }
+    }
+  };
+
+  // Spreads the low 16 bits of v to the even bits.
+  constexpr uint32_t SpreadBits(uint32_t v)
+  {
+    v &= 0xffff;
+    v = (v | (v << 8)) & 0x00ff00ff;
+    v = (v | (v << 4)) & 0x0f0f0f0f;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+  }
+
+  constexpr uint32_t Morton(uint32_t x, uint32_t y)
+  {
+    return SpreadBits(x) | SpreadBits(y) << 1;
+  }
+
+  // S x S tiles like Tiled<S, S>, pixels inside a tile in Morton (Z) order,
+  // so any aligned 2^k square of pixels is contiguous. Best for filters
+  // reading 2D neighborhoods.
+  template <int S>
+  requires(S >= 4 && (S & (S - 1)) == 0)
+  struct MortonTiled
+  {
+    static constexpr uint32_t kId = 2;
+    static constexpr bool kRowMajor = false;
+    static constexpr int kTileWidth = S;
+    static constexpr int kTileHeight = S;
+
+    static std::size_t Components(int w, int h)
+    {
+      return Tiled<S, S>::Components(w, h);
+    }
+
+    static std::size_t Index(int x, int y, int w)
+    {
+      auto tile = (y / S) * Tiled<S, S>::TilesX(w) + x / S;
+      return 3 * (tile * S * S + Morton(x % S, y % S));
+    }
+
+    // Horizontal neighbors pair up, so copies go two pixels at a time
+    template <typename T>
+    static void CopyRow(const T *data, int w, int y, T *out)
+    {
+      int x = 0;
+      for (; x + 1 < w; x += 2)
+        std::memcpy(out + 3 * x, data + Index(x, y, w), 6 * sizeof(T));
+      if (x < w)
+        std::memcpy(out + 3 * x, data + Index(x, y, w), 3 * sizeof(T));
+    }
+
+    template <typename T>
+    static void StoreRow(T *data, int w, int y, const T *in)
+    {
+      int x = 0;
+      for (; x + 1 < w; x += 2)
+        std::memcpy(data + Index(x, y, w), in + 3 * x, 6 * sizeof(T));
+      if (x < w)
+        std::memcpy(data + Index(x, y, w), in + 3 * x, 3 * sizeof(T));
+    }
+  };
+} // End CanvasLayout
+
+#endif // CANVAS_LAYOUT_H
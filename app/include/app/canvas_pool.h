@@ -0,0 +1,112 @@
+#ifndef CANVAS_POOL_H
+#define CANVAS_POOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "app/canvas.h"
+
+// Recycles canvas buffers across frames. An animation that acquires a
+// canvas per frame and releases it once written out allocates (and page
+// faults) only for the first few frames, later ones reuse the same
+// already-resident memory. The dirty-tile flags are recycled along with
+// the components, so a hit allocates nothing at all.
+template <typename T, typename Layout = CanvasLayout::RowMajor>
+requires std::floating_point<T>
+class CanvasPool
+{
+public:
+  // Keeps at most `capacity` idle buffers, further releases are freed.
+  explicit CanvasPool(std::size_t capacity = 4, PageSize pages = PageSize::Default)
+      : capacity_{capacity}, pages_{pages}
+  {
+  }
+
+  CanvasPool(const CanvasPool &) = delete;
+  CanvasPool &operator=(const CanvasPool &) = delete;
+
+  // A cleared w x h canvas, from an idle buffer of the same size if there
+  // is one.
+  Canvas<T, Layout> acquire(int w, int h)
+  {
+    auto size = Layout::Components(w, h);
+    auto idle = Idle();
+    {
+      auto lock = std::lock_guard(mx_);
+      auto it = std::find_if(free_.begin(), free_.end(), [size](const auto &i)
+                             { return i.buffer.size() == size; });
+      if (it != free_.end())
+      {
+        idle = std::move(*it);
+        free_.erase(it);
+        hits_++;
+      }
+      else
+      {
+        misses_++;
+      }
+    }
+    // Clearing or allocating a large buffer is slow, keep it out of the lock
+    if (idle.buffer.size() == 0 && size > 0)
+      return Canvas<T, Layout>(w, h, pages_);
+    idle.buffer.clear();
+    // Same component count doesn't mean the same shape, e.g. 64 x 32 and
+    // 32 x 64 row-major canvases
+    if (idle.dirty.width() == w && idle.dirty.height() == h)
+      idle.dirty.markAll();
+    else
+      idle.dirty = DirtyTiles(w, h);
+    return Canvas<T, Layout>(std::move(idle.buffer), std::move(idle.dirty), w, h);
+  }
+
+  // Hands a canvas' buffer back for reuse, the canvas is left empty.
+  void release(Canvas<T, Layout> &&canvas)
+  {
+    auto idle = Idle{std::move(canvas.data_), std::move(canvas.dirty_)};
+    canvas.w_ = 0;
+    canvas.h_ = 0;
+    // File-backed buffers go back to their file, never into the pool
+    if (idle.buffer.size() == 0 || idle.buffer.region())
+      return;
+    auto lock = std::lock_guard(mx_);
+    if (free_.size() < capacity_)
+      free_.push_back(std::move(idle));
+  }
+
+  std::size_t idle() const
+  {
+    auto lock = std::lock_guard(mx_);
+    return free_.size();
+  }
+
+  // acquire() calls served from the pool, and those that allocated
+  std::size_t hits() const
+  {
+    auto lock = std::lock_guard(mx_);
+    return hits_;
+  }
+
+  std::size_t misses() const
+  {
+    auto lock = std::lock_guard(mx_);
+    return misses_;
+  }
+
+private:
+  struct Idle
+  {
+    CanvasBuffer<T> buffer;
+    DirtyTiles dirty;
+  };
+
+  mutable std::mutex mx_;
+  std::vector<Idle> free_;
+  std::size_t capacity_;
+  PageSize pages_;
+  std::size_t hits_ = 0;
+  std::size_t misses_ = 0;
+};
+
+#endif // CANVAS_POOL_H
@@ -0,0 +1,37 @@
+#ifndef DEMO_SCENE_H
+#define DEMO_SCENE_H
+
+#include <algorithm>
+#include <cmath>
+
+#include "color.h"
+
+// A diffuse sphere lit from the upper left, what the preview window and
+// rtc_render draw until there is a real scene to trace.
+struct SphereScene
+{
+  // Center in [-1, 1] image coordinates, (0, 0) is the middle
+  float x = 0.f;
+  float y = 0.f;
+  // Fraction of the smaller image side
+  float radius = 0.3f;
+  Color::Color<float> color{1.f, 1.f, 1.f};
+
+  // Color at continuous pixel coordinates (u, v) of a w x h image, pixel
+  // (x, y) covering [x, x + 1) x [y, y + 1).
+  Color::Color<float> shade(float u, float v, int w, int h) const
+  {
+    auto r = radius * std::min(w, h);
+    auto dx = (u - (w / 2.f) * (1.f + x)) / r;
+    auto dy = (v - (h / 2.f) * (1.f + y)) / r;
+    auto d2 = dx * dx + dy * dy;
+    if (d2 > 1.f)
+      return Color::Color<float>(0.f, 0.f, 0.f);
+    auto dz = std::sqrt(1.f - d2);
+    // Light from (-1, -1, 1) / sqrt(3)
+    auto lambert = std::max(0.f, (-dx - dy + dz) * 0.57735f);
+    return color * (0.1f + 0.9f * lambert);
+  }
+};
+
+#endif // DEMO_SCENE_H
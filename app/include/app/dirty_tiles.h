@@ -0,0 +1,149 @@
+#ifndef DIRTY_TILES_H
+#define DIRTY_TILES_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+struct DirtyRect
+{
+  int x, y, w, h;
+
+  bool operator==(const DirtyRect &) const = default;
+};
+
+// One flag per kTileSize x kTileSize block of a canvas, set by writes and
+// collected by the preview to upload only what changed. Marking is a
+// relaxed load (plus a store the first time), cheap enough for every
+// writePixel() and safe from any number of threads.
+class DirtyTiles
+{
+public:
+  static constexpr int kTileSize = 64;
+
+  DirtyTiles() = default;
+
+  // Everything starts dirty, nothing has been uploaded yet
+  DirtyTiles(int w, int h)
+      : w_{w}, h_{h},
+        tilesX_{(w + kTileSize - 1) / kTileSize},
+        tilesY_{(h + kTileSize - 1) / kTileSize},
+        flags_{new std::atomic<uint8_t>[static_cast<std::size_t>(tilesX_) * tilesY_]}
+  {
+    allocations_.fetch_add(1, std::memory_order_relaxed);
+    markAll();
+  }
+
+  DirtyTiles(const DirtyTiles &rhs) : DirtyTiles(rhs.w_, rhs.h_)
+  {
+    for (std::size_t i = 0; i < count(); i++)
+      flags_[i].store(rhs.flags_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+
+  // Moved-from trackers cover an empty canvas
+  DirtyTiles(DirtyTiles &&rhs) noexcept
+      : w_{std::exchange(rhs.w_, 0)}, h_{std::exchange(rhs.h_, 0)},
+        tilesX_{std::exchange(rhs.tilesX_, 0)}, tilesY_{std::exchange(rhs.tilesY_, 0)},
+        flags_{std::move(rhs.flags_)}
+  {
+  }
+
+  DirtyTiles &operator=(const DirtyTiles &rhs)
+  {
+    if (this != &rhs)
+      *this = DirtyTiles(rhs);
+    return *this;
+  }
+
+  DirtyTiles &operator=(DirtyTiles &&rhs) noexcept
+  {
+    w_ = std::exchange(rhs.w_, 0);
+    h_ = std::exchange(rhs.h_, 0);
+    tilesX_ = std::exchange(rhs.tilesX_, 0);
+    tilesY_ = std::exchange(rhs.tilesY_, 0);
+    flags_ = std::move(rhs.flags_);
+    return *this;
+  }
+
+  // Flag arrays allocated since startup, so tests can check recycled
+  // canvases don't allocate new ones
+  static std::size_t Allocations() { return allocations_.load(std::memory_order_relaxed); }
+
+  int width() const { return w_; }
+  int height() const { return h_; }
+
+  void mark(int x, int y)
+  {
+    auto &flag = flags_[static_cast<std::size_t>(y / kTileSize) * tilesX_ + x / kTileSize];
+    // Skip the store (and the cache line bounce) once a tile is dirty
+    if (!flag.load(std::memory_order_relaxed))
+      flag.store(1, std::memory_order_relaxed);
+  }
+
+  // Marks every tile overlapping the w x h rectangle at (x, y)
+  void mark(int x, int y, int w, int h)
+  {
+    if (w <= 0 || h <= 0)
+      return;
+    for (int ty = y / kTileSize; ty <= (y + h - 1) / kTileSize; ty++)
+    {
+      for (int tx = x / kTileSize; tx <= (x + w - 1) / kTileSize; tx++)
+      {
+        flags_[static_cast<std::size_t>(ty) * tilesX_ + tx].store(1, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void markAll()
+  {
+    for (std::size_t i = 0; i < count(); i++)
+      flags_[i].store(1, std::memory_order_relaxed);
+  }
+
+  // Clears every flag and returns the dirty areas, runs of dirty tiles in
+  // a tile row merged into one rectangle and clipped to the canvas.
+  std::vector<DirtyRect> take()
+  {
+    auto res = std::vector<DirtyRect>();
+    for (int ty = 0; ty < tilesY_; ty++)
+    {
+      int run = -1;
+      for (int tx = 0; tx <= tilesX_; tx++)
+      {
+        bool dirty = tx < tilesX_ && flags_[static_cast<std::size_t>(ty) * tilesX_ + tx].exchange(0, std::memory_order_relaxed);
+        if (dirty && run < 0)
+        {
+          run = tx;
+        }
+        else if (!dirty && run >= 0)
+        {
+          auto x = run * kTileSize;
+          auto y = ty * kTileSize;
+          res.push_back({x, y, std::min(tx * kTileSize, w_) - x, std::min(y + kTileSize, h_) - y});
+          run = -1;
+        }
+      }
+    }
+    return res;
+  }
+
+private:
+  std::size_t count() const
+  {
+    return static_cast<std::size_t>(tilesX_) * tilesY_;
+  }
+
+  static inline std::atomic<std::size_t> allocations_{0};
+
+  int w_ = 0;
+  int h_ = 0;
+  int tilesX_ = 0;
+  int tilesY_ = 0;
+  std::unique_ptr<std::atomic<uint8_t>[]> flags_;
+};
+
+#endif // DIRTY_TILES_H
@@ -0,0 +1,177 @@
+#ifndef FILE_IO_H
+#define FILE_IO_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Buffered writer straight to a file descriptor. Output goes through one
+// fixed-size buffer, so encoders can stream arbitrarily large images
+// without holding them in memory.
+class FileWriter
+{
+public:
+  static constexpr std::size_t kBufferSize = 1 << 16;
+
+  explicit FileWriter(const std::string &filename);
+  ~FileWriter();
+
+  FileWriter(const FileWriter &) = delete;
+  FileWriter &operator=(const FileWriter &) = delete;
+
+  void write(const char *data, std::size_t size);
+
+  void write(std::string_view s)
+  {
+    write(s.data(), s.size());
+  }
+
+  // Bytes handed to write() so far, flushed or not.
+  std::size_t offset() const
+  {
+    return offset_;
+  }
+
+  // True for a regular file. Pipes, FIFOs and terminals can't seek, so
+  // reserve() and writeAt() only work when this is true.
+  bool seekable() const
+  {
+    return seekable_;
+  }
+
+  // Leaves a hole of `size` bytes at the current position and returns its
+  // file offset, to be filled concurrently with writeAt().
+  std::size_t reserve(std::size_t size);
+
+  // Positioned write (pwrite), safe to call from several threads at once.
+  // Does not move the position write() appends at.
+  void writeAt(const char *data, std::size_t size, std::size_t offset);
+
+  void flush();
+  void close();
+
+private:
+  int fd_;
+  std::unique_ptr<char[]> buffer_;
+  std::size_t used_ = 0;
+  std::size_t offset_ = 0;
+  bool seekable_ = false;
+};
+
+// Buffered reader straight from a file descriptor, for parsers that
+// stream files too large to map or hold in memory.
+class FileReader
+{
+public:
+  static constexpr std::size_t kBufferSize = 1 << 16;
+
+  explicit FileReader(const std::string &filename);
+  ~FileReader();
+
+  FileReader(const FileReader &) = delete;
+  FileReader &operator=(const FileReader &) = delete;
+
+  // Next byte, -1 at the end of the file
+  int get()
+  {
+    if (pos_ == end_ && !refill())
+      return -1;
+    return static_cast<unsigned char>(buffer_[pos_++]);
+  }
+
+  // Bytes buffered but not consumed yet, refilled first when there are
+  // none. Empty only at the end of the file.
+  std::string_view buffered();
+
+  void consume(std::size_t size)
+  {
+    pos_ += size;
+  }
+
+  // Reads `size` bytes, fewer only at the end of the file.
+  std::size_t read(char *data, std::size_t size);
+
+private:
+  bool refill();
+
+  int fd_;
+  std::unique_ptr<char[]> buffer_;
+  std::size_t pos_ = 0;
+  std::size_t end_ = 0;
+};
+
+// Read-only mapping of a whole file. Pages are faulted in on access, so
+// parsers run straight over the file without copying it into a buffer.
+class MappedFile
+{
+public:
+  explicit MappedFile(const std::string &filename);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  const char *data() const
+  {
+    return data_;
+  }
+
+  std::size_t size() const
+  {
+    return size_;
+  }
+
+private:
+  const char *data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+// Shared read-write mapping of a file, created sparse (ftruncate) if it
+// is new or empty, so disk blocks are only allocated for pages actually
+// written. An existing file must already have the requested size.
+//
+// The size is fixed for the life of the mapping: there is no grow or
+// remap, and data() stays valid until destruction. Sparse creation is
+// what keeps a large region cheap, not growth.
+class MappedRegion
+{
+public:
+  MappedRegion(const std::string &filename, std::size_t size);
+  ~MappedRegion();
+
+  MappedRegion(const MappedRegion &) = delete;
+  MappedRegion &operator=(const MappedRegion &) = delete;
+
+  char *data()
+  {
+    return data_;
+  }
+
+  const char *data() const
+  {
+    return data_;
+  }
+
+  std::size_t size() const
+  {
+    return size_;
+  }
+
+  // True if the file was new or empty, false if existing contents were
+  // mapped
+  bool created() const
+  {
+    return created_;
+  }
+
+  // Blocks until every dirty page is on disk (msync).
+  void sync();
+
+private:
+  char *data_ = nullptr;
+  std::size_t size_ = 0;
+  bool created_ = false;
+};
+
+#endif // FILE_IO_H
@@ -2,6 +2,8 @@
 #define RTC_PRIMITIVES_MATH_H_
 
 #include <stdlib.h>
+#include <cmath>
+#include <type_traits>
 
 #define PI 3.14159265358979323846
 
@@ -12,4 +14,40 @@ const float GROUP_INFINITE_BIGNUM = 10e6;
 
 inline bool epsilon_eq(float a, float b) { return abs(a - b) < EPSILON; };
 
+namespace detail
+{
+  constexpr long double PI_L = 3.141592653589793238462643383279502884L;
+
+  // Taylor series after reducing x to [-pi, pi], accurate to long double.
+  constexpr long double SinCosSeries(long double x, bool cosine)
+  {
+    auto turns = x / (2 * PI_L);
+    x -= static_cast<long long>(turns < 0 ? turns - 0.5L : turns + 0.5L) * 2 * PI_L;
+    long double term = cosine ? 1.0L : x;
+    long double sum = term;
+    for (int power = cosine ? 0 : 1; power < 48; power += 2)
+    {
+      term *= -x * x / ((power + 1) * (power + 2));
+      sum += term;
+    }
+    return sum;
+  }
+}
+
+// sin/cos that can be evaluated in constant expressions, so transforms built
+// from literal angles fold at compile time. At runtime they are std::sin/cos.
+constexpr auto constexpr_sin(auto rads) -> decltype(std::sin(rads))
+{
+  if (std::is_constant_evaluated())
+    return static_cast<decltype(std::sin(rads))>(detail::SinCosSeries(rads, false));
+  return std::sin(rads);
+}
+
+constexpr auto constexpr_cos(auto rads) -> decltype(std::cos(rads))
+{
+  if (std::is_constant_evaluated())
+    return static_cast<decltype(std::cos(rads))>(detail::SinCosSeries(rads, true));
+  return std::cos(rads);
+}
+
 #endif // RTC_PRIMITIVES_MATH_H_
\ No newline at end of file
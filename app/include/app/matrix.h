@@ -1,7 +1,9 @@
 #ifndef MATRIX_H
 #define MATRIX_H
 
+#include <array>
 #include <cassert>
+#include <cstddef>
 #include <vector>
 #include <cstdint>
 #include <stdexcept>
@@ -19,18 +21,29 @@ namespace Matrix
   template <class T>
   requires Number<T>
   class Matrix;
-  auto Translation(auto x, decltype(x) y, decltype(x) z) -> Matrix<decltype(x)>;
-  auto Scaling(auto x, decltype(x) y, decltype(x) z) -> Matrix<decltype(x)>;
-  auto RotationX(auto rads) -> Matrix<decltype(rads)>;
-  auto RotationY(auto rads) -> Matrix<decltype(rads)>;
-  auto RotationZ(auto rads) -> Matrix<decltype(rads)>;
-  auto Shearing(auto xy,
-                decltype(xy) xz,
-                decltype(xy) yx,
-                decltype(xy) yz,
-                decltype(xy) zx,
-                decltype(xy) zy)
-      -> Matrix<decltype(xy)>;
+  template <class T, std::size_t N>
+  requires Number<T>
+  class FixedMatrix;
+
+  template <class T>
+  using Matrix4 = FixedMatrix<T, 4>;
+  template <class T>
+  using Matrix3 = FixedMatrix<T, 3>;
+  template <class T>
+  using Matrix2 = FixedMatrix<T, 2>;
+
+  constexpr auto Translation(auto x, decltype(x) y, decltype(x) z) -> Matrix4<decltype(x)>;
+  constexpr auto Scaling(auto x, decltype(x) y, decltype(x) z) -> Matrix4<decltype(x)>;
+  constexpr auto RotationX(auto rads) -> Matrix4<decltype(rads)>;
+  constexpr auto RotationY(auto rads) -> Matrix4<decltype(rads)>;
+  constexpr auto RotationZ(auto rads) -> Matrix4<decltype(rads)>;
+  constexpr auto Shearing(auto xy,
+                          decltype(xy) xz,
+                          decltype(xy) yx,
+                          decltype(xy) yz,
+                          decltype(xy) zx,
+                          decltype(xy) zy)
+      -> Matrix4<decltype(xy)>;
 
   // CODE
   template <class T>
@@ -196,12 +209,14 @@ namespace Matrix
       return true;
     }
 
+    // Recursive cofactor inverse, kept as the reference implementation.
+    // Use FixedMatrix for 2x2/3x3/4x4 work, it inverts in closed form.
     Matrix<T> inverse() const
     {
-      if (!invertible())
+      auto determinant = det();
+      if (determinant == static_cast<T>(0))
         throw std::runtime_error("Not invertible");
       auto res = Matrix<T>(rows_, cols_);
-      auto determinant = det();
       for (auto y = 0; y < cols_; y++)
       {
         for (auto x = 0; x < rows_; x++)
@@ -245,6 +260,395 @@ namespace Matrix
   private:
   };
 
+  // Square matrix with contiguous, row-major storage held inline.
+  // Matrix4 backs every transform, Matrix3/Matrix2 back the cofactor path,
+  // so none of them ever touch the heap.
+  template <class T, std::size_t N>
+  requires Number<T>
+  class FixedMatrix
+  {
+    alignas(N == 4 ? 32 : 16) std::array<T, N * N> data_{};
+
+  public:
+    constexpr FixedMatrix() = default;
+
+    constexpr FixedMatrix(const T (&m)[N][N])
+    {
+      for (std::size_t x = 0; x < N; x++)
+      {
+        for (std::size_t y = 0; y < N; y++)
+        {
+          data_[x * N + y] = m[x][y];
+        }
+      }
+    }
+
+    explicit FixedMatrix(const Matrix<T> &m)
+    {
+      assert(m.rows() == N);
+      assert(m.cols() == N);
+      for (std::size_t x = 0; x < N; x++)
+      {
+        for (std::size_t y = 0; y < N; y++)
+        {
+          data_[x * N + y] = m(x, y);
+        }
+      }
+    }
+
+    // Allows mixing with dynamically sized matrices (and tuples through them)
+    operator Matrix<T>() const
+    {
+      auto res = Matrix<T>(N, N);
+      for (std::size_t x = 0; x < N; x++)
+      {
+        for (std::size_t y = 0; y < N; y++)
+        {
+          res(x, y) = data_[x * N + y];
+        }
+      }
+      return res;
+    }
+
+    static constexpr uint_fast32_t rows()
+    {
+      return N;
+    }
+
+    static constexpr uint_fast32_t cols()
+    {
+      return N;
+    }
+
+    constexpr const T operator()(uint_fast32_t row, uint_fast32_t col) const
+    {
+      assert(row < N);
+      assert(col < N);
+      return data_[row * N + col];
+    }
+
+    constexpr T &operator()(uint_fast32_t row, uint_fast32_t col)
+    {
+      assert(row < N);
+      assert(col < N);
+      return data_[row * N + col];
+    }
+
+    constexpr const T *data() const
+    {
+      return data_.data();
+    }
+
+    constexpr T *data()
+    {
+      return data_.data();
+    }
+
+    bool operator==(const FixedMatrix<T, N> &rhs) const
+    {
+      for (std::size_t i = 0; i < N * N; i++)
+      {
+        if (!epsilon_eq(data_[i], rhs.data_[i]))
+          return false;
+      }
+      return true;
+    }
+
+    constexpr FixedMatrix<T, N> operator*(const FixedMatrix<T, N> &rhs) const
+    {
+      auto res = FixedMatrix<T, N>();
+      for (std::size_t x = 0; x < N; x++)
+      {
+        for (std::size_t i = 0; i < N; i++)
+        {
+          auto lhs = data_[x * N + i];
+          for (std::size_t y = 0; y < N; y++)
+          {
+            res.data_[x * N + y] += lhs * rhs.data_[i * N + y];
+          }
+        }
+      }
+      return res;
+    }
+
+    Matrix<T> operator*(const Matrix<T> &rhs) const
+    {
+      assert(rhs.rows() == N);
+      auto res = Matrix<T>(N, rhs.cols());
+      for (uint_fast32_t y = 0; y < rhs.cols(); y++)
+      {
+        for (std::size_t x = 0; x < N; x++)
+        {
+          T result = (T)0;
+          for (std::size_t i = 0; i < N; i++)
+          {
+            result += data_[x * N + i] * rhs(i, y);
+          }
+          res(x, y) = result;
+        }
+      }
+      return res;
+    }
+
+    constexpr FixedMatrix<T, N> identity() const
+    {
+      auto res = FixedMatrix<T, N>();
+      for (std::size_t i = 0; i < N; i++)
+      {
+        res.data_[i * N + i] = (T)1;
+      }
+      return res;
+    }
+
+    // Transpose
+    constexpr FixedMatrix<T, N> t() const
+    {
+      auto res = FixedMatrix<T, N>();
+      for (std::size_t x = 0; x < N; x++)
+      {
+        for (std::size_t y = 0; y < N; y++)
+        {
+          res.data_[y * N + x] = data_[x * N + y];
+        }
+      }
+      return res;
+    }
+
+    // Closed form up to 4x4, larger sizes fall back to cofactor expansion.
+    constexpr T det() const
+    {
+      const auto &a = data_;
+      if constexpr (N == 1)
+      {
+        return a[0];
+      }
+      else if constexpr (N == 2)
+      {
+        return a[0] * a[3] - a[1] * a[2];
+      }
+      else if constexpr (N == 3)
+      {
+        return a[0] * (a[4] * a[8] - a[5] * a[7]) +
+               a[1] * (a[5] * a[6] - a[3] * a[8]) +
+               a[2] * (a[3] * a[7] - a[4] * a[6]);
+      }
+      else if constexpr (N == 4)
+      {
+        auto s = PairDets();
+        return s[0] * s[11] - s[1] * s[10] + s[2] * s[9] +
+               s[3] * s[8] - s[4] * s[7] + s[5] * s[6];
+      }
+      else
+      {
+        return det_cofactor();
+      }
+    }
+
+    // Recursive cofactor expansion, kept as a reference for det()
+    constexpr T det_cofactor() const
+    {
+      if constexpr (N <= 2)
+      {
+        return det();
+      }
+      else
+      {
+        T result = static_cast<T>(0);
+        for (std::size_t i = 0; i < N; i++)
+        {
+          result += data_[i] * cofactor(0, i);
+        }
+        return result;
+      }
+    }
+
+    constexpr T minor(uint_fast32_t row, uint_fast32_t col) const
+    requires(N > 1)
+    {
+      return submatrix(row, col).det_cofactor();
+    }
+
+    constexpr T cofactor(uint_fast32_t row, uint_fast32_t col) const
+    requires(N > 1)
+    {
+      auto change_sign = (row + col) % 2 == 0 ? 1 : -1;
+      return static_cast<T>(change_sign) * minor(row, col);
+    }
+
+    constexpr FixedMatrix<T, N - 1> submatrix(uint_fast32_t row, uint_fast32_t col) const
+    requires(N > 1)
+    {
+      assert(row < N);
+      assert(col < N);
+      auto res = FixedMatrix<T, N - 1>();
+      auto write_row = 0;
+      for (std::size_t x = 0; x < N; x++)
+      {
+        if (x == row)
+          continue;
+        auto write_col = 0;
+        for (std::size_t y = 0; y < N; y++)
+        {
+          if (y == col)
+            continue;
+          res(write_row, write_col) = data_[x * N + y];
+          write_col++;
+        }
+        write_row++;
+      }
+      return res;
+    }
+
+    constexpr bool invertible() const
+    {
+      if (det() == static_cast<T>(0))
+      {
+        return false;
+      }
+      return true;
+    }
+
+    // Closed form up to 4x4: the determinant is computed once and, for 4x4,
+    // shares its 2x2 sub-determinants with the adjugate.
+    constexpr FixedMatrix<T, N> inverse() const
+    requires(N > 1)
+    {
+      const auto &a = data_;
+      auto res = FixedMatrix<T, N>();
+      auto &b = res.data_;
+      if constexpr (N == 2)
+      {
+        auto determinant = det();
+        if (determinant == static_cast<T>(0))
+          throw std::runtime_error("Not invertible");
+        auto inv = static_cast<T>(1) / determinant;
+        b = {a[3] * inv, -a[1] * inv,
+             -a[2] * inv, a[0] * inv};
+      }
+      else if constexpr (N == 3)
+      {
+        auto c0 = a[4] * a[8] - a[5] * a[7];
+        auto c1 = a[5] * a[6] - a[3] * a[8];
+        auto c2 = a[3] * a[7] - a[4] * a[6];
+        auto determinant = a[0] * c0 + a[1] * c1 + a[2] * c2;
+        if (determinant == static_cast<T>(0))
+          throw std::runtime_error("Not invertible");
+        auto inv = static_cast<T>(1) / determinant;
+        b = {c0 * inv, (a[2] * a[7] - a[1] * a[8]) * inv, (a[1] * a[5] - a[2] * a[4]) * inv,
+             c1 * inv, (a[0] * a[8] - a[2] * a[6]) * inv, (a[2] * a[3] - a[0] * a[5]) * inv,
+             c2 * inv, (a[1] * a[6] - a[0] * a[7]) * inv, (a[0] * a[4] - a[1] * a[3]) * inv};
+      }
+      else if constexpr (N == 4)
+      {
+        auto s = PairDets();
+        auto determinant = s[0] * s[11] - s[1] * s[10] + s[2] * s[9] +
+                           s[3] * s[8] - s[4] * s[7] + s[5] * s[6];
+        if (determinant == static_cast<T>(0))
+          throw std::runtime_error("Not invertible");
+        auto inv = static_cast<T>(1) / determinant;
+        b = {(a[5] * s[11] - a[6] * s[10] + a[7] * s[9]) * inv,
+             (-a[1] * s[11] + a[2] * s[10] - a[3] * s[9]) * inv,
+             (a[13] * s[5] - a[14] * s[4] + a[15] * s[3]) * inv,
+             (-a[9] * s[5] + a[10] * s[4] - a[11] * s[3]) * inv,
+
+             (-a[4] * s[11] + a[6] * s[8] - a[7] * s[7]) * inv,
+             (a[0] * s[11] - a[2] * s[8] + a[3] * s[7]) * inv,
+             (-a[12] * s[5] + a[14] * s[2] - a[15] * s[1]) * inv,
+             (a[8] * s[5] - a[10] * s[2] + a[11] * s[1]) * inv,
+
+             (a[4] * s[10] - a[5] * s[8] + a[7] * s[6]) * inv,
+             (-a[0] * s[10] + a[1] * s[8] - a[3] * s[6]) * inv,
+             (a[12] * s[4] - a[13] * s[2] + a[15] * s[0]) * inv,
+             (-a[8] * s[4] + a[9] * s[2] - a[11] * s[0]) * inv,
+
+             (-a[4] * s[9] + a[5] * s[7] - a[6] * s[6]) * inv,
+             (a[0] * s[9] - a[1] * s[7] + a[2] * s[6]) * inv,
+             (-a[12] * s[3] + a[13] * s[1] - a[14] * s[0]) * inv,
+             (a[8] * s[3] - a[9] * s[1] + a[10] * s[0]) * inv};
+      }
+      else
+      {
+        res = inverse_cofactor();
+      }
+      return res;
+    }
+
+    // Recursive cofactor inverse, kept as a reference for inverse()
+    constexpr FixedMatrix<T, N> inverse_cofactor() const
+    requires(N > 1)
+    {
+      auto determinant = det_cofactor();
+      if (determinant == static_cast<T>(0))
+        throw std::runtime_error("Not invertible");
+      auto res = FixedMatrix<T, N>();
+      for (std::size_t y = 0; y < N; y++)
+      {
+        for (std::size_t x = 0; x < N; x++)
+        {
+          res.data_[y * N + x] = cofactor(x, y) / determinant;
+        }
+      }
+      return res;
+    }
+
+    constexpr FixedMatrix<T, N> translate(T x, T y, T z) const
+    requires(N == 4)
+    {
+      return Translation(x, y, z) * *this;
+    }
+
+    constexpr FixedMatrix<T, N> scale(T x, T y, T z) const
+    requires(N == 4)
+    {
+      return Scaling(x, y, z) * *this;
+    }
+
+    constexpr FixedMatrix<T, N> rotate_x(T rads) const
+    requires(N == 4)
+    {
+      return RotationX(rads) * *this;
+    }
+
+    constexpr FixedMatrix<T, N> rotate_y(T rads) const
+    requires(N == 4)
+    {
+      return RotationY(rads) * *this;
+    }
+
+    constexpr FixedMatrix<T, N> rotate_z(T rads) const
+    requires(N == 4)
+    {
+      return RotationZ(rads) * *this;
+    }
+
+    constexpr FixedMatrix<T, N> shear(T xy, T xz, T yx, T yz, T zx, T zy) const
+    requires(N == 4)
+    {
+      return Shearing(xy, xz, yx, yz, zx, zy) * *this;
+    }
+
+  private:
+    // 2x2 sub-determinants of the top two rows [0..5] and the bottom two
+    // rows [6..11] of a 4x4, shared by det() and inverse().
+    constexpr std::array<T, 12> PairDets() const
+    requires(N == 4)
+    {
+      const auto &a = data_;
+      return {a[0] * a[5] - a[4] * a[1],
+              a[0] * a[6] - a[4] * a[2],
+              a[0] * a[7] - a[4] * a[3],
+              a[1] * a[6] - a[5] * a[2],
+              a[1] * a[7] - a[5] * a[3],
+              a[2] * a[7] - a[6] * a[3],
+              a[8] * a[13] - a[12] * a[9],
+              a[8] * a[14] - a[12] * a[10],
+              a[8] * a[15] - a[12] * a[11],
+              a[9] * a[14] - a[13] * a[10],
+              a[9] * a[15] - a[13] * a[11],
+              a[10] * a[15] - a[14] * a[11]};
+    }
+  };
+
   template <class T>
   requires Number<T>
       Matrix<T> Identity(uint_fast32_t size)
@@ -257,64 +661,71 @@ namespace Matrix
     return res;
   }
 
+  template <class T, std::size_t N = 4>
+  requires Number<T>
+  constexpr FixedMatrix<T, N> Identity()
+  {
+    return FixedMatrix<T, N>().identity();
+  }
+
   // Transforms
-  auto Translation(auto x, decltype(x) y, decltype(x) z) -> Matrix<decltype(x)>
+  constexpr auto Translation(auto x, decltype(x) y, decltype(x) z) -> Matrix4<decltype(x)>
   {
-    auto t = Identity<decltype(x)>(4);
+    auto t = Identity<decltype(x)>();
     t(0, 3) = x;
     t(1, 3) = y;
     t(2, 3) = z;
     return t;
   }
 
-  auto Scaling(auto x, decltype(x) y, decltype(x) z) -> Matrix<decltype(x)>
+  constexpr auto Scaling(auto x, decltype(x) y, decltype(x) z) -> Matrix4<decltype(x)>
   {
-    auto t = Identity<decltype(x)>(4);
+    auto t = Identity<decltype(x)>();
     t(0, 0) = x;
     t(1, 1) = y;
     t(2, 2) = z;
     return t;
   }
 
-  auto RotationX(auto rads) -> Matrix<decltype(rads)>
+  constexpr auto RotationX(auto rads) -> Matrix4<decltype(rads)>
   {
-    auto t = Identity<decltype(rads)>(4);
-    t(1, 1) = cos(rads);
-    t(1, 2) = -1 * sin(rads);
-    t(2, 1) = sin(rads);
-    t(2, 2) = cos(rads);
+    auto t = Identity<decltype(rads)>();
+    t(1, 1) = constexpr_cos(rads);
+    t(1, 2) = -1 * constexpr_sin(rads);
+    t(2, 1) = constexpr_sin(rads);
+    t(2, 2) = constexpr_cos(rads);
     return t;
   }
 
-  auto RotationY(auto rads) -> Matrix<decltype(rads)>
+  constexpr auto RotationY(auto rads) -> Matrix4<decltype(rads)>
   {
-    auto t = Identity<decltype(rads)>(4);
-    t(0, 0) = cos(rads);
-    t(0, 2) = sin(rads);
-    t(2, 0) = -1 * sin(rads);
-    t(2, 2) = cos(rads);
+    auto t = Identity<decltype(rads)>();
+    t(0, 0) = constexpr_cos(rads);
+    t(0, 2) = constexpr_sin(rads);
+    t(2, 0) = -1 * constexpr_sin(rads);
+    t(2, 2) = constexpr_cos(rads);
     return t;
   }
 
-  auto RotationZ(auto rads) -> Matrix<decltype(rads)>
+  constexpr auto RotationZ(auto rads) -> Matrix4<decltype(rads)>
   {
-    auto t = Identity<decltype(rads)>(4);
-    t(0, 0) = cos(rads);
-    t(0, 1) = -1 * sin(rads);
-    t(1, 0) = sin(rads);
-    t(1, 1) = cos(rads);
+    auto t = Identity<decltype(rads)>();
+    t(0, 0) = constexpr_cos(rads);
+    t(0, 1) = -1 * constexpr_sin(rads);
+    t(1, 0) = constexpr_sin(rads);
+    t(1, 1) = constexpr_cos(rads);
     return t;
   }
 
-  auto Shearing(auto xy,
-                decltype(xy) xz,
-                decltype(xy) yx,
-                decltype(xy) yz,
-                decltype(xy) zx,
-                decltype(xy) zy)
-      -> Matrix<decltype(xy)>
+  constexpr auto Shearing(auto xy,
+                          decltype(xy) xz,
+                          decltype(xy) yx,
+                          decltype(xy) yz,
+                          decltype(xy) zx,
+                          decltype(xy) zy)
+      -> Matrix4<decltype(xy)>
   {
-    auto t = Identity<decltype(xy)>(4);
+    auto t = Identity<decltype(xy)>();
     t(0, 1) = xy;
     t(0, 2) = xz;
     t(1, 0) = yx;
@@ -0,0 +1,93 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Parallel
+{
+  // 0 means "one per hardware thread".
+  inline unsigned ResolveThreads(unsigned threads)
+  {
+    if (threads != 0)
+      return threads;
+    auto hw = std::thread::hardware_concurrency();
+    return hw == 0 ? 1 : hw;
+  }
+
+  // Runs a copy of `fn` on each of `count` threads. The first exception
+  // thrown by any of them is rethrown from join(), the destructor joins
+  // without throwing.
+  class WorkerGroup
+  {
+    std::vector<std::thread> threads_;
+    std::mutex mx_;
+    std::exception_ptr error_;
+
+  public:
+    template <typename Fn>
+    WorkerGroup(unsigned count, Fn fn)
+    {
+      threads_.reserve(count);
+      try
+      {
+        for (unsigned i = 0; i < count; i++)
+        {
+          threads_.emplace_back([this, fn]() mutable
+                                {
+                                  try
+                                  {
+                                    fn();
+                                  }
+                                  catch (...)
+                                  {
+                                    fail(std::current_exception());
+                                  } });
+        }
+      }
+      catch (...)
+      {
+        // The destructor won't run, don't leave joinable threads behind
+        wait();
+        throw;
+      }
+    }
+
+    WorkerGroup(const WorkerGroup &) = delete;
+    WorkerGroup &operator=(const WorkerGroup &) = delete;
+
+    ~WorkerGroup()
+    {
+      wait();
+    }
+
+    void join()
+    {
+      wait();
+      if (error_)
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+
+  private:
+    void wait()
+    {
+      for (auto &t : threads_)
+      {
+        if (t.joinable())
+          t.join();
+      }
+    }
+
+    void fail(std::exception_ptr e)
+    {
+      auto lock = std::lock_guard(mx_);
+      if (!error_)
+        error_ = e;
+    }
+  };
+} // End Parallel
+
+#endif // PARALLEL_H
@@ -0,0 +1,31 @@
+#ifndef PERF_PANEL_H
+#define PERF_PANEL_H
+
+#include <array>
+#include <cstddef>
+
+// The "Performance" ImGui window: a rolling frame-time histogram, render
+// throughput, preview upload size, canvas memory and, in RTC_PROFILING
+// builds, the per-frame stage timings recorded with RTC_PROFILE_SCOPE.
+class PerfPanel
+{
+public:
+  static constexpr int kHistory = 240;
+
+  // Closes a frame that took `seconds` of wall time, during which
+  // `samples` were shaded and `uploadBytes` sent to the preview texture.
+  void frame(double seconds, std::size_t samples, std::size_t uploadBytes);
+
+  // Call between ImGui::NewFrame() and ImGui::Render()
+  void draw() const;
+
+private:
+  std::array<float, kHistory> frameMs_{};
+  // Oldest entry, where the next frame goes
+  int next_ = 0;
+  int filled_ = 0;
+  double samplesPerSecond_ = 0;
+  std::size_t uploadBytes_ = 0;
+};
+
+#endif // PERF_PANEL_H
@@ -0,0 +1,290 @@
+#ifndef PPM_H
+#define PPM_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "app/file_io.h"
+#include "app/parallel.h"
+
+namespace PPM
+{
+  // Same result as std::clamp((int)std::ceil(c * 255), 0, 255) without the
+  // libm call, NaN maps to 0.
+  template <typename T>
+  requires std::floating_point<T>
+  inline uint8_t Quantize(T c)
+  {
+    T v = c * static_cast<T>(255);
+    if (!(v > static_cast<T>(0)))
+      return 0;
+    if (v >= static_cast<T>(255))
+      return 255;
+    auto i = static_cast<int>(v);
+    return static_cast<uint8_t>(i + (static_cast<T>(i) < v));
+  }
+
+  // Quantizes one row of interleaved r, g, b components.
+  template <typename T>
+  requires std::floating_point<T>
+  inline void QuantizeRow(const T *rgb, int w, uint8_t *out)
+  {
+    for (int i = 0; i < 3 * w; i++)
+    {
+      out[i] = Quantize(rgb[i]);
+    }
+  }
+
+  // "0 " to "255 ": every value with its trailing separator, padded to four
+  // bytes so it can be copied with a single fixed-size memcpy.
+  struct DigitTable
+  {
+    std::array<std::array<char, 4>, 256> text{};
+    std::array<uint8_t, 256> len{};
+  };
+
+  constexpr DigitTable MakeDigitTable()
+  {
+    DigitTable table;
+    for (int v = 0; v < 256; v++)
+    {
+      auto &t = table.text[v];
+      int n = 0;
+      if (v >= 100)
+        t[n++] = static_cast<char>('0' + v / 100);
+      if (v >= 10)
+        t[n++] = static_cast<char>('0' + v / 10 % 10);
+      t[n++] = static_cast<char>('0' + v % 10);
+      t[n++] = ' ';
+      table.len[v] = static_cast<uint8_t>(n);
+    }
+    return table;
+  }
+
+  inline constexpr DigitTable kDigits = MakeDigitTable();
+
+  // Formats rows of an ASCII (P3) payload, reusing its buffers row to row.
+  template <typename T>
+  requires std::floating_point<T>
+  class P3RowEncoder
+  {
+    int w_;
+    std::vector<uint8_t> quantized_;
+    std::vector<char> text_;
+
+  public:
+    // Widest row is "255 " per component, plus fixed-size copy slack
+    explicit P3RowEncoder(int w) : w_{w}, quantized_(3 * w), text_(12 * w + 4){};
+
+    // Row text including its trailing newline
+    std::string_view encode(const T *rgb)
+    {
+      if (w_ == 0)
+        return "\n";
+      QuantizeRow(rgb, w_, quantized_.data());
+      char *p = text_.data();
+      for (auto v : quantized_)
+      {
+        std::memcpy(p, kDigits.text[v].data(), 4);
+        p += kDigits.len[v];
+      }
+      p[-1] = '\n';
+      return std::string_view(text_.data(), p - text_.data());
+    }
+  };
+
+  // Streams a P3 payload (as produced by Canvas::mkPPMPayload) one row at a
+  // time, `row(y)` returns the r, g, b components of row y. `out` is a
+  // FileWriter or anything else with write(std::string_view).
+  template <typename T, typename Out, typename RowFn>
+  requires std::floating_point<T>
+  void WriteP3Payload(Out &out, int w, int h, RowFn &&row)
+  {
+    auto encoder = P3RowEncoder<T>(w);
+    for (int y = 0; y < h; y++)
+    {
+      out.write(encoder.encode(row(y)));
+    }
+    out.write("\n");
+  }
+
+  // Streams a binary (P6) payload, one quantized byte per component.
+  template <typename T, typename RowFn>
+  requires std::floating_point<T>
+  void WriteP6Payload(FileWriter &out, int w, int h, RowFn &&row)
+  {
+    auto quantized = std::vector<uint8_t>(3 * w);
+    for (int y = 0; y < h; y++)
+    {
+      QuantizeRow(row(y), w, quantized.data());
+      out.write(reinterpret_cast<const char *>(quantized.data()), quantized.size());
+    }
+  }
+
+  // Rows per band for the parallel writers: roughly 256 KiB of quantized
+  // data, but at least four bands per thread so a slow band doesn't leave
+  // the other threads idle.
+  inline int BandRows(int w, int h, unsigned threads)
+  {
+    auto rowBytes = std::max<std::size_t>(3 * static_cast<std::size_t>(w), 1);
+    auto bySize = static_cast<int>(std::max<std::size_t>((1 << 18) / rowBytes, 1));
+    auto byThreads = std::max(1, h / static_cast<int>(4 * threads));
+    return std::min(bySize, byThreads);
+  }
+
+  struct BandSplit
+  {
+    int rows;
+    int count;
+    unsigned threads;
+  };
+
+  // Splits h rows into bands for `threads` threads (0 for all cores). A
+  // thread per core is too many for a short image, extra ones would only
+  // start up and exit, so threads are capped at the number of bands.
+  inline BandSplit CapThreadsToBands(int w, int h, unsigned threads)
+  {
+    threads = Parallel::ResolveThreads(threads);
+    const int rows = BandRows(w, h, threads);
+    const int count = (h + rows - 1) / rows;
+    return {rows, count, std::min(threads, static_cast<unsigned>(std::max(count, 1)))};
+  }
+
+  // WriteP3Payload with the formatting spread over `threads` worker threads
+  // (0 for all cores). Workers format whole bands of rows into their own
+  // buffers, the calling thread writes the bands out in order. At most two
+  // bands per worker are in flight, so memory stays bounded however large
+  // the image is.
+  template <typename T, typename Out, typename RowFn>
+  requires std::floating_point<T>
+  void WriteP3PayloadParallel(Out &out, int w, int h, RowFn &&row, unsigned threads = 0)
+  {
+    const auto split = CapThreadsToBands(w, h, threads);
+    const int band = split.rows;
+    const int bands = split.count;
+    threads = split.threads;
+    if (threads <= 1)
+      return WriteP3Payload<T>(out, w, h, row);
+
+    const int window = 2 * static_cast<int>(threads);
+    auto slots = std::vector<std::string>(window);
+    auto ready = std::vector<char>(window, 0);
+    std::mutex mx;
+    std::condition_variable cv;
+    int next = 0;
+    int written = 0;
+    bool failed = false;
+    // Wakes everyone up to bail out, whichever side hit an error
+    auto fail = [&]
+    {
+      auto lock = std::lock_guard(mx);
+      failed = true;
+      cv.notify_all();
+    };
+
+    auto workers = Parallel::WorkerGroup(threads, [&]
+                                         {
+      auto encoder = P3RowEncoder<T>(w);
+      try
+      {
+        for (;;)
+        {
+          int b;
+          {
+            auto lock = std::unique_lock(mx);
+            cv.wait(lock, [&]
+                    { return failed || next >= bands || next < written + window; });
+            if (failed || next >= bands)
+              return;
+            b = next++;
+          }
+          auto text = std::string();
+          for (int y = b * band; y < std::min(h, (b + 1) * band); y++)
+          {
+            text.append(encoder.encode(row(y)));
+          }
+          auto lock = std::lock_guard(mx);
+          slots[b % window] = std::move(text);
+          ready[b % window] = 1;
+          cv.notify_all();
+        }
+      }
+      catch (...)
+      {
+        fail();
+        throw;
+      } });
+
+    try
+    {
+      for (int b = 0; b < bands; b++)
+      {
+        std::string text;
+        {
+          auto lock = std::unique_lock(mx);
+          cv.wait(lock, [&]
+                  { return failed || ready[b % window]; });
+          if (failed)
+            break;
+          text = std::move(slots[b % window]);
+          ready[b % window] = 0;
+          written = b + 1;
+          cv.notify_all();
+        }
+        out.write(text);
+      }
+    }
+    catch (...)
+    {
+      fail();
+      throw;
+    }
+    workers.join();
+    out.write("\n");
+  }
+
+  // WriteP6Payload spread over `threads` worker threads (0 for all cores).
+  // Every row has the same size, so bands are quantized independently and
+  // written with pwrite straight to their final offset.
+  template <typename T, typename RowFn>
+  requires std::floating_point<T>
+  void WriteP6PayloadParallel(FileWriter &out, int w, int h, RowFn &&row, unsigned threads = 0)
+  {
+    const auto split = CapThreadsToBands(w, h, threads);
+    const int band = split.rows;
+    const int bands = split.count;
+    threads = split.threads;
+    if (threads <= 1)
+      return WriteP6Payload<T>(out, w, h, row);
+
+    const auto stride = 3 * static_cast<std::size_t>(w);
+    const auto base = out.reserve(stride * h);
+    auto next = std::atomic<int>(0);
+
+    auto workers = Parallel::WorkerGroup(threads, [&]
+                                         {
+      auto quantized = std::vector<uint8_t>(stride * band);
+      for (int b; (b = next.fetch_add(1, std::memory_order_relaxed)) < bands;)
+      {
+        const int y0 = b * band;
+        const int y1 = std::min(h, y0 + band);
+        for (int y = y0; y < y1; y++)
+        {
+          QuantizeRow(row(y), w, quantized.data() + (y - y0) * stride);
+        }
+        out.writeAt(reinterpret_cast<const char *>(quantized.data()), (y1 - y0) * stride, base + y0 * stride);
+      } });
+    workers.join();
+  }
+} // End PPM
+
+#endif // PPM_H
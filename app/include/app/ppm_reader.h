@@ -0,0 +1,250 @@
+#ifndef PPM_READER_H
+#define PPM_READER_H
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "app/file_io.h"
+#include "app/ppm.h"
+
+namespace PPM
+{
+  struct Header
+  {
+    bool binary = false;
+    int width = 0;
+    int height = 0;
+    int maxval = 255;
+  };
+
+  inline bool IsSpace(int c)
+  {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+  }
+
+  // Reads bytes out of memory with the same get() as FileReader.
+  struct MemoryReader
+  {
+    const char *p;
+    const char *end;
+
+    int get()
+    {
+      return p < end ? static_cast<unsigned char>(*p++) : -1;
+    }
+  };
+
+  // Parses a P3 or P6 header, comments included, up to and including the
+  // single whitespace byte in front of the payload. `in` is a FileReader or
+  // MemoryReader.
+  template <typename Reader>
+  Header ReadHeader(Reader &in)
+  {
+    auto p = in.get();
+    auto n = in.get();
+    if (p != 'P' || (n != '3' && n != '6'))
+      throw std::runtime_error("Not a P3/P6 PPM image");
+
+    auto header = Header();
+    header.binary = n == '6';
+    auto c = in.get();
+    auto field = [&in, &c](int max)
+    {
+      for (;;)
+      {
+        if (c == '#')
+        {
+          while (c != '\n' && c != -1)
+            c = in.get();
+        }
+        else if (IsSpace(c))
+        {
+          c = in.get();
+        }
+        else
+        {
+          break;
+        }
+      }
+      if (c < '0' || c > '9')
+        throw std::runtime_error("Malformed PPM header");
+      long v = 0;
+      for (; c >= '0' && c <= '9'; c = in.get())
+      {
+        v = v * 10 + (c - '0');
+        if (v > max)
+          throw std::runtime_error("PPM header value out of range");
+      }
+      return static_cast<int>(v);
+    };
+    header.width = field(INT_MAX / 3);
+    header.height = field(INT_MAX / 3);
+    header.maxval = field(65535);
+    if (header.maxval == 0 || !IsSpace(c))
+      throw std::runtime_error("Malformed PPM header");
+    return header;
+  }
+
+  // Sample to component lookup, the inverse of Quantize(): for maxval 255
+  // every entry quantizes back to its own index, so images survive any
+  // number of load/save round trips. Samples above maxval saturate.
+  template <typename T>
+  requires std::floating_point<T>
+  std::vector<T> DequantizeTable(int maxval)
+  {
+    auto res = std::vector<T>(maxval > 255 ? 65536 : 256, static_cast<T>(1));
+    for (int v = 0; v <= maxval; v++)
+    {
+      auto c = static_cast<T>(v) / static_cast<T>(maxval);
+      if (maxval == 255)
+      {
+        while (Quantize(c) > v)
+          c = std::nextafter(c, static_cast<T>(0));
+      }
+      res[v] = c;
+    }
+    return res;
+  }
+
+  // Incremental parser for P3 samples. Input can arrive in arbitrary
+  // chunks, a number cut at the end of one chunk is carried over to the
+  // next. 16 bytes at a time are classified with SSE2 compares, so runs of
+  // whitespace are skipped in one step and only digits are touched.
+  class P3Scanner
+  {
+  public:
+    explicit P3Scanner(int maxval) : maxval_{maxval} {}
+
+    // Parses samples from [p, end) into out[got] until `got` reaches
+    // `want` or the input runs out, returns where it stopped.
+    const char *scan(const char *p, const char *end, uint16_t *out, std::size_t want, std::size_t &got);
+
+    // At the end of the input, completes a sample running up to the last
+    // byte.
+    void finish(uint16_t *out, std::size_t want, std::size_t &got);
+
+  private:
+    void emit(uint16_t *out, std::size_t &got);
+
+    int maxval_;
+    uint32_t value_ = 0;
+    bool inNumber_ = false;
+  };
+
+  // Throws unless `available` bytes can hold the payload `header` promises:
+  // exactly that for P6, at least a digit per sample and a space between
+  // them for P3. Lets a loader reject a lying header before it allocates
+  // the whole image.
+  inline void CheckPayloadSize(const Header &header, std::size_t available)
+  {
+    // Fits easily, both sides are at most INT_MAX / 3
+    auto samples = 3 * static_cast<std::size_t>(header.width) * header.height;
+    auto need = header.binary ? samples * (header.maxval > 255 ? 2 : 1) : samples == 0 ? 0 : 2 * samples - 1;
+    if (available < need)
+      throw std::runtime_error("Truncated PPM payload");
+  }
+
+  // Decodes the payload starting at `p` into interleaved r, g, b components.
+  template <typename T>
+  requires std::floating_point<T>
+  void DecodePayload(const char *p, const char *end, const Header &header, T *rgb)
+  {
+    const auto table = DequantizeTable<T>(header.maxval);
+    const auto rowSize = 3 * static_cast<std::size_t>(header.width);
+    const auto size = rowSize * header.height;
+    if (header.binary)
+    {
+      auto bytes = header.maxval > 255 ? 2u : 1u;
+      if (static_cast<std::size_t>(end - p) < size * bytes)
+        throw std::runtime_error("Truncated PPM payload");
+      auto u = reinterpret_cast<const uint8_t *>(p);
+      if (bytes == 1)
+      {
+        for (std::size_t i = 0; i < size; i++)
+          rgb[i] = table[u[i]];
+      }
+      else
+      {
+        for (std::size_t i = 0; i < size; i++)
+          rgb[i] = table[u[2 * i] << 8 | u[2 * i + 1]];
+      }
+      return;
+    }
+
+    auto scanner = P3Scanner(header.maxval);
+    auto samples = std::vector<uint16_t>(rowSize);
+    for (int y = 0; y < header.height; y++)
+    {
+      std::size_t got = 0;
+      p = scanner.scan(p, end, samples.data(), rowSize, got);
+      if (got < rowSize)
+        scanner.finish(samples.data(), rowSize, got);
+      if (got < rowSize)
+        throw std::runtime_error("Truncated PPM payload");
+      for (std::size_t i = 0; i < rowSize; i++)
+        rgb[y * rowSize + i] = table[samples[i]];
+    }
+  }
+
+  // Decodes a P3/P6 file one row at a time through a small read buffer,
+  // for images too large to load whole. `fn(y, rgb)` gets the r, g, b
+  // components of each row in order.
+  template <typename T, typename RowFn>
+  requires std::floating_point<T>
+  Header StreamRows(const std::string &filename, RowFn &&fn)
+  {
+    auto in = FileReader(filename);
+    const auto header = ReadHeader(in);
+    const auto table = DequantizeTable<T>(header.maxval);
+    const auto rowSize = 3 * static_cast<std::size_t>(header.width);
+    auto row = std::vector<T>(rowSize);
+
+    if (header.binary)
+    {
+      auto bytes = header.maxval > 255 ? 2u : 1u;
+      auto raw = std::vector<uint8_t>(rowSize * bytes);
+      for (int y = 0; y < header.height; y++)
+      {
+        if (in.read(reinterpret_cast<char *>(raw.data()), raw.size()) != raw.size())
+          throw std::runtime_error("Truncated PPM payload");
+        for (std::size_t i = 0; i < rowSize; i++)
+          row[i] = table[bytes == 1 ? raw[i] : raw[2 * i] << 8 | raw[2 * i + 1]];
+        fn(y, static_cast<const T *>(row.data()));
+      }
+      return header;
+    }
+
+    auto scanner = P3Scanner(header.maxval);
+    auto samples = std::vector<uint16_t>(rowSize);
+    for (int y = 0; y < header.height; y++)
+    {
+      std::size_t got = 0;
+      while (got < rowSize)
+      {
+        auto buf = in.buffered();
+        if (buf.empty())
+        {
+          scanner.finish(samples.data(), rowSize, got);
+          if (got < rowSize)
+            throw std::runtime_error("Truncated PPM payload");
+          break;
+        }
+        auto stop = scanner.scan(buf.data(), buf.data() + buf.size(), samples.data(), rowSize, got);
+        in.consume(stop - buf.data());
+      }
+      for (std::size_t i = 0; i < rowSize; i++)
+        row[i] = table[samples[i]];
+      fn(y, static_cast<const T *>(row.data()));
+    }
+    return header;
+  }
+} // End PPM
+
+#endif // PPM_READER_H
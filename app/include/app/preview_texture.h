@@ -0,0 +1,46 @@
+#ifndef PREVIEW_TEXTURE_H
+#define PREVIEW_TEXTURE_H
+
+#include <GL/glew.h>
+
+#include "app/canvas.h"
+
+// The preview window's view of a canvas. The texture is allocated once and
+// only the canvas' dirty rectangles are uploaded each frame, packed into
+// one of two pixel buffer objects in turn: the driver copies from one PBO
+// to the texture while the next frame fills the other, so the upload
+// overlaps rendering instead of stalling the UI thread.
+//
+// Needs a current GL context for its whole lifetime.
+class PreviewTexture
+{
+public:
+  PreviewTexture(int w, int h);
+  ~PreviewTexture();
+
+  PreviewTexture(const PreviewTexture &) = delete;
+  PreviewTexture &operator=(const PreviewTexture &) = delete;
+
+  // Uploads whatever changed in `canvas` since the last update
+  void update(Canvas<float> &canvas);
+
+  GLuint id() const
+  {
+    return texture_;
+  }
+
+  // Bytes handed to GL by the last update(), 0 if nothing changed
+  std::size_t lastUploadBytes() const
+  {
+    return lastUploadBytes_;
+  }
+
+private:
+  int w_, h_;
+  GLuint texture_ = 0;
+  GLuint pbos_[2] = {0, 0};
+  int next_ = 0;
+  std::size_t lastUploadBytes_ = 0;
+};
+
+#endif // PREVIEW_TEXTURE_H
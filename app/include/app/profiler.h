@@ -0,0 +1,102 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Named stage timings and counters, collected per frame for the
+// performance panel. Meant for coarse stages (a frame step, a tile, a file
+// write): every record takes a mutex.
+//
+// Use the RTC_PROFILE_SCOPE / RTC_PROFILE_COUNT macros rather than the
+// classes directly. Without RTC_PROFILING they expand to nothing, so
+// instrumented code pays nothing in builds that leave it out.
+namespace Profiling
+{
+  struct StageStats
+  {
+    std::string name;
+    // Summed over the last frame, over all threads
+    double seconds = 0;
+    uint64_t calls = 0;
+    // Smoothed over recent frames
+    double averageSeconds = 0;
+  };
+
+  struct CounterStats
+  {
+    std::string name;
+    uint64_t lastFrame = 0;
+    double perSecond = 0;
+  };
+
+  class Profiler
+  {
+  public:
+    static Profiler &Instance();
+
+    void record(std::string_view stage, double seconds);
+    void count(std::string_view counter, uint64_t n);
+
+    // Closes the current frame, which took `seconds` of wall time
+    void endFrame(double seconds);
+
+    std::vector<StageStats> stages() const;
+    std::vector<CounterStats> counters() const;
+
+  private:
+    struct Stage
+    {
+      StageStats stats;
+      double pendingSeconds = 0;
+      uint64_t pendingCalls = 0;
+    };
+
+    struct Counter
+    {
+      CounterStats stats;
+      uint64_t pending = 0;
+    };
+
+    mutable std::mutex mx_;
+    std::vector<Stage> stages_;
+    std::vector<Counter> counters_;
+  };
+
+  // Records the time from construction to destruction under `stage`, which
+  // must outlive the timer (string literals do).
+  class ScopedTimer
+  {
+  public:
+    explicit ScopedTimer(std::string_view stage) : stage_{stage}, start_{std::chrono::steady_clock::now()} {}
+
+    ~ScopedTimer()
+    {
+      Profiler::Instance().record(stage_, std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count());
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+  private:
+    std::string_view stage_;
+    std::chrono::steady_clock::time_point start_;
+  };
+} // End Profiling
+
+#define RTC_PROFILE_CONCAT_(a, b) a##b
+#define RTC_PROFILE_CONCAT(a, b) RTC_PROFILE_CONCAT_(a, b)
+
+#if defined(RTC_PROFILING)
+#define RTC_PROFILE_SCOPE(stage) ::Profiling::ScopedTimer RTC_PROFILE_CONCAT(rtcProfileScope, __LINE__)(stage)
+#define RTC_PROFILE_COUNT(counter, n) ::Profiling::Profiler::Instance().count(counter, n)
+#else
+#define RTC_PROFILE_SCOPE(stage) ((void)0)
+#define RTC_PROFILE_COUNT(counter, n) ((void)0)
+#endif
+
+#endif // PROFILER_H
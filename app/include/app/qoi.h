@@ -0,0 +1,242 @@
+#ifndef QOI_H
+#define QOI_H
+
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "app/file_io.h"
+#include "app/ppm.h"
+
+// The "Quite OK Image" format (https://qoiformat.org/qoi-specification.pdf),
+// lossless and simple enough to encode at render speed. Only 3 channel
+// images are produced, alpha is always 255.
+namespace QOI
+{
+  constexpr uint8_t OP_INDEX = 0x00;
+  constexpr uint8_t OP_DIFF = 0x40;
+  constexpr uint8_t OP_LUMA = 0x80;
+  constexpr uint8_t OP_RUN = 0xc0;
+  constexpr uint8_t OP_RGB = 0xfe;
+  constexpr uint8_t OP_RGBA = 0xff;
+  constexpr uint8_t MASK_2 = 0xc0;
+
+  constexpr std::array<uint8_t, 8> kEndMarker = {0, 0, 0, 0, 0, 0, 0, 1};
+
+  // Same limit as the reference decoder, keeps a bad header from asking
+  // for an unbounded allocation
+  constexpr std::size_t kMaxPixels = 400000000;
+
+  // Longest run a single op can encode
+  constexpr std::size_t kMaxRun = 62;
+
+  struct Pixel
+  {
+    uint8_t r = 0, g = 0, b = 0, a = 255;
+
+    bool operator==(const Pixel &) const = default;
+
+    int hash() const
+    {
+      return (r * 3 + g * 5 + b * 7 + a * 11) % 64;
+    }
+  };
+
+  // Encodes rows of quantized r, g, b bytes as they arrive.
+  class Encoder
+  {
+    FileWriter &out_;
+    std::array<Pixel, 64> index_{};
+    Pixel prev_;
+    int run_ = 0;
+    // Worst case per pixel is OP_RGB, plus one pending run
+    std::vector<uint8_t> bytes_;
+
+  public:
+    Encoder(FileWriter &out, int w, int h) : out_{out}, bytes_(4 * w + 1)
+    {
+      index_.fill(Pixel{0, 0, 0, 0});
+      uint8_t header[14] = {'q', 'o', 'i', 'f',
+                            static_cast<uint8_t>(w >> 24), static_cast<uint8_t>(w >> 16),
+                            static_cast<uint8_t>(w >> 8), static_cast<uint8_t>(w),
+                            static_cast<uint8_t>(h >> 24), static_cast<uint8_t>(h >> 16),
+                            static_cast<uint8_t>(h >> 8), static_cast<uint8_t>(h),
+                            3, 0};
+      out_.write(reinterpret_cast<const char *>(header), sizeof(header));
+    }
+
+    void writeRow(const uint8_t *rgb, int w)
+    {
+      uint8_t *p = bytes_.data();
+      for (int i = 0; i < w; i++)
+      {
+        auto px = Pixel{rgb[3 * i], rgb[3 * i + 1], rgb[3 * i + 2], 255};
+        if (px == prev_)
+        {
+          if (++run_ == 62)
+          {
+            *p++ = OP_RUN | (run_ - 1);
+            run_ = 0;
+          }
+          continue;
+        }
+        if (run_ > 0)
+        {
+          *p++ = OP_RUN | (run_ - 1);
+          run_ = 0;
+        }
+        auto pos = px.hash();
+        if (index_[pos] == px)
+        {
+          *p++ = OP_INDEX | pos;
+        }
+        else
+        {
+          index_[pos] = px;
+          int8_t vr = px.r - prev_.r;
+          int8_t vg = px.g - prev_.g;
+          int8_t vb = px.b - prev_.b;
+          int8_t vg_r = vr - vg;
+          int8_t vg_b = vb - vg;
+          if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+          {
+            *p++ = OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2);
+          }
+          else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8)
+          {
+            *p++ = OP_LUMA | (vg + 32);
+            *p++ = (vg_r + 8) << 4 | (vg_b + 8);
+          }
+          else
+          {
+            *p++ = OP_RGB;
+            *p++ = px.r;
+            *p++ = px.g;
+            *p++ = px.b;
+          }
+        }
+        prev_ = px;
+      }
+      out_.write(reinterpret_cast<const char *>(bytes_.data()), p - bytes_.data());
+    }
+
+    void finish()
+    {
+      if (run_ > 0)
+      {
+        uint8_t op = OP_RUN | (run_ - 1);
+        out_.write(reinterpret_cast<const char *>(&op), 1);
+        run_ = 0;
+      }
+      out_.write(reinterpret_cast<const char *>(kEndMarker.data()), kEndMarker.size());
+    }
+  };
+
+  // Streams a canvas as QOI, `row(y)` returns the r, g, b components of
+  // row y.
+  template <typename T, typename RowFn>
+  requires std::floating_point<T>
+  void Write(FileWriter &out, int w, int h, RowFn &&row)
+  {
+    auto encoder = Encoder(out, w, h);
+    auto quantized = std::vector<uint8_t>(3 * w);
+    for (int y = 0; y < h; y++)
+    {
+      PPM::QuantizeRow(row(y), w, quantized.data());
+      encoder.writeRow(quantized.data(), w);
+    }
+    encoder.finish();
+  }
+
+  // Decodes a QOI image to interleaved r, g, b bytes (alpha is dropped).
+  // Throws on a bad header or on data that ends before the last pixel.
+  inline std::vector<uint8_t> Decode(const uint8_t *data, std::size_t size, int &w, int &h)
+  {
+    if (size < 14 + kEndMarker.size() || data[0] != 'q' || data[1] != 'o' || data[2] != 'i' || data[3] != 'f')
+      throw std::runtime_error("Not a QOI image");
+    auto be32 = [](const uint8_t *p)
+    { return static_cast<uint32_t>(p[0]) << 24 | p[1] << 16 | p[2] << 8 | p[3]; };
+    auto width = be32(data + 4);
+    auto height = be32(data + 8);
+    std::size_t p = 14;
+    std::size_t end = size - kEndMarker.size();
+    if (width == 0 || height == 0 || width > kMaxPixels / height)
+      throw std::runtime_error("QOI image size out of range");
+    auto pixels = static_cast<std::size_t>(width) * height;
+    // Every op covers at most kMaxRun pixels, so a short file can't claim
+    // a huge image
+    if (pixels > (end - p) * kMaxRun)
+      throw std::runtime_error("Truncated QOI image");
+    w = static_cast<int>(width);
+    h = static_cast<int>(height);
+
+    auto res = std::vector<uint8_t>(3 * pixels);
+    auto index = std::array<Pixel, 64>{};
+    index.fill(Pixel{0, 0, 0, 0});
+    auto px = Pixel();
+    // Operand bytes following the op at p - 1
+    auto need = [&](std::size_t n)
+    {
+      if (n > end - p)
+        throw std::runtime_error("Truncated QOI image");
+    };
+    int run = 0;
+    for (std::size_t i = 0; i < res.size(); i += 3)
+    {
+      if (run > 0)
+      {
+        run--;
+      }
+      else
+      {
+        need(1);
+        auto op = data[p++];
+        if (op == OP_RGB)
+        {
+          need(3);
+          px.r = data[p++];
+          px.g = data[p++];
+          px.b = data[p++];
+        }
+        else if (op == OP_RGBA)
+        {
+          need(4);
+          px = Pixel{data[p], data[p + 1], data[p + 2], data[p + 3]};
+          p += 4;
+        }
+        else if ((op & MASK_2) == OP_INDEX)
+        {
+          px = index[op];
+        }
+        else if ((op & MASK_2) == OP_DIFF)
+        {
+          px.r += ((op >> 4) & 0x03) - 2;
+          px.g += ((op >> 2) & 0x03) - 2;
+          px.b += (op & 0x03) - 2;
+        }
+        else if ((op & MASK_2) == OP_LUMA)
+        {
+          need(1);
+          auto next = data[p++];
+          int vg = (op & 0x3f) - 32;
+          px.r += vg - 8 + ((next >> 4) & 0x0f);
+          px.g += vg;
+          px.b += vg - 8 + (next & 0x0f);
+        }
+        else
+        {
+          run = op & 0x3f;
+        }
+        index[px.hash()] = px;
+      }
+      res[i] = px.r;
+      res[i + 1] = px.g;
+      res[i + 2] = px.b;
+    }
+    return res;
+  }
+} // End QOI
+
+#endif // QOI_H
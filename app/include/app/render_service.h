@@ -0,0 +1,389 @@
+#ifndef RENDER_SERVICE_H
+#define RENDER_SERVICE_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "color.h"
+#include "app/accumulation.h"
+#include "app/canvas.h"
+#include "app/dirty_tiles.h"
+#include "app/parallel.h"
+#include "app/profiler.h"
+#include "app/tile_queue.h"
+
+// Renders images on background threads and hands them to the UI tile by
+// tile. Workers shade kTileSize x kTileSize tiles into their own buffers,
+// center first, and publish them through a lock-free TileQueue; the UI
+// thread copies whatever has arrived into its canvas with drain(), never
+// waiting on a worker.
+//
+// start() replaces the image being rendered, e.g. when a parameter
+// changes. Tiles still in flight for the old one are dropped, the canvas
+// keeps showing them until the new tiles cover them. An image can also be
+// rendered at 1/scale resolution, one shaded sample filling each
+// scale x scale block, for a quick preview while the input keeps changing.
+//
+// At full resolution an image can take several samples per pixel. They are
+// rendered as passes of one sample per pixel, added to an
+// AccumulationBuffer, and every tile of a later pass shows the mean so far,
+// so the preview converges while nothing changes.
+template <typename T>
+requires std::floating_point<T>
+class RenderService
+{
+public:
+  static constexpr int kTileSize = 32;
+
+  // Color at continuous pixel coordinates (u, v), pixel (x, y) covering
+  // [x, x + 1) x [y, y + 1). Called from the worker threads.
+  using Shader = std::function<Color::Color<T>(T u, T v)>;
+
+  // Shading work behind the tiles drained so far
+  struct Stats
+  {
+    std::size_t samples = 0;
+    // Summed over the workers, so up to threads() per second of wall time
+    double seconds = 0;
+  };
+
+  RenderService(int w, int h, unsigned threads = 0, std::size_t queueCapacity = 64)
+      : w_{w}, h_{h},
+        tilesX_{(w + kTileSize - 1) / kTileSize},
+        tilesY_{(h + kTileSize - 1) / kTileSize},
+        threads_{Parallel::ResolveThreads(threads)},
+        queue_(queueCapacity),
+        tilePass_(static_cast<std::size_t>(tilesX_) * tilesY_),
+        workers_(threads_, [this]()
+                 { work(); })
+  {
+    assert(w >= 0);
+    assert(h >= 0);
+  }
+
+  ~RenderService()
+  {
+    {
+      auto lock = std::lock_guard(mx_);
+      stop_.store(true, std::memory_order_relaxed);
+    }
+    cv_.notify_all();
+    // workers_ is destroyed first and joins
+  }
+
+  RenderService(const RenderService &) = delete;
+  RenderService &operator=(const RenderService &) = delete;
+
+  int width() const { return w_; }
+  int height() const { return h_; }
+  unsigned threads() const { return threads_; }
+
+  // Starts rendering a new image, abandoning the current one. `scale` is a
+  // power of two up to kTileSize; `samples` per pixel only apply at scale 1,
+  // a reduced resolution pass always takes one per block. Only takes the
+  // lock the workers use to pick up jobs, never one held while shading.
+  void start(Shader shader, int scale = 1, int samples = 1)
+  {
+    assert(scale > 0 && (scale & (scale - 1)) == 0 && scale <= kTileSize);
+    assert(samples > 0);
+    auto job = std::make_shared<Job>();
+    job->generation = generation_.fetch_add(1, std::memory_order_relaxed) + 1;
+    job->shader = std::move(shader);
+    job->scale = scale;
+    job->passes = scale == 1 ? samples : 1;
+    job->order = tileOrder();
+    if (job->passes > 1)
+      job->accum = accumulation();
+    current_ = job->accum.get();
+    std::fill(tilePass_.begin(), tilePass_.end(), -1);
+    done_ = 0;
+    total_ = job->order.size() * job->passes;
+    {
+      auto lock = std::lock_guard(mx_);
+      job_ = std::move(job);
+    }
+    cv_.notify_all();
+  }
+
+  // Stops rendering. Tiles already in the canvas stay.
+  void cancel()
+  {
+    generation_.fetch_add(1, std::memory_order_relaxed);
+    done_ = 0;
+    total_ = 0;
+    current_ = nullptr;
+    auto lock = std::lock_guard(mx_);
+    job_.reset();
+  }
+
+  // Copies up to `maxTiles` finished tiles of the current image into
+  // `canvas` and returns how many. Call from the thread that calls start().
+  template <typename Layout>
+  std::size_t drain(Canvas<T, Layout> &canvas, std::size_t maxTiles = std::numeric_limits<std::size_t>::max())
+  {
+    assert(canvas.width() == w_);
+    assert(canvas.height() == h_);
+    auto generation = generation_.load(std::memory_order_relaxed);
+    std::size_t n = 0;
+    while (n < maxTiles)
+    {
+      auto tile = queue_.pop();
+      if (!tile)
+        break;
+      if (tile->generation != generation)
+        continue;
+      // Passes of one tile can finish out of order on different threads,
+      // an older one would hide samples the canvas already shows
+      auto &pass = tilePass_[tile->index];
+      if (tile->pass >= pass)
+      {
+        canvas.storeRect(tile->rect, tile->rgb.data());
+        pass = tile->pass;
+      }
+      stats_.samples += tile->samples;
+      stats_.seconds += tile->seconds;
+      n++;
+    }
+    done_ += n;
+    // Every tile is pushed after adding its samples, so once all of them
+    // are here the buffer is complete, even where a tile's last pass read
+    // it before another thread's earlier pass was done
+    if (n > 0 && current_ && done_ == total_)
+      current_->resolve(canvas);
+    return n;
+  }
+
+  // Work behind the tiles drained since the last call
+  Stats takeStats()
+  {
+    return std::exchange(stats_, Stats{});
+  }
+
+  // Tiles of the current image drained so far, and in total
+  std::size_t tilesDone() const { return done_; }
+  std::size_t tileCount() const { return total_; }
+
+  bool finished() const
+  {
+    return done_ == total_;
+  }
+
+private:
+  struct Job
+  {
+    uint64_t generation = 0;
+    Shader shader;
+    int scale = 1;
+    // Samples per pixel, each a pass over every tile
+    int passes = 1;
+    // Where the passes are added up, only when there are several
+    std::shared_ptr<AccumulationBuffer<T>> accum;
+    // Tile indices, nearest to the center first
+    std::vector<int> order;
+    std::atomic<std::size_t> next{0};
+  };
+
+  struct Tile
+  {
+    uint64_t generation = 0;
+    int index = 0;
+    int pass = 0;
+    DirtyRect rect{};
+    std::vector<T> rgb;
+    std::size_t samples = 0;
+    double seconds = 0;
+  };
+
+  std::vector<int> tileOrder() const
+  {
+    auto order = std::vector<int>(static_cast<std::size_t>(tilesX_) * tilesY_);
+    for (std::size_t i = 0; i < order.size(); i++)
+      order[i] = static_cast<int>(i);
+    auto distance = [this](int i)
+    {
+      auto dx = (i % tilesX_) * 2 + 1 - tilesX_;
+      auto dy = (i / tilesX_) * 2 + 1 - tilesY_;
+      return dx * dx + dy * dy;
+    };
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+                     { return distance(a) < distance(b); });
+    return order;
+  }
+
+  // A cleared buffer no earlier job still adds to. Two are kept: the job
+  // being replaced usually holds one while its workers notice, and the one
+  // before it has let go of the other by then.
+  std::shared_ptr<AccumulationBuffer<T>> accumulation()
+  {
+    for (auto &accum : accums_)
+    {
+      if (accum && accum.use_count() == 1)
+      {
+        // Pairs with the release of the last job that held it
+        std::atomic_thread_fence(std::memory_order_acquire);
+        accum->clear();
+        return accum;
+      }
+    }
+    auto &slot = accums_[0] && !accums_[1] ? accums_[1] : accums_[0];
+    slot = std::make_shared<AccumulationBuffer<T>>(w_, h_);
+    return slot;
+  }
+
+  bool stale(const Job &job) const
+  {
+    return job.generation != generation_.load(std::memory_order_relaxed) || stop_.load(std::memory_order_relaxed);
+  }
+
+  void work()
+  {
+    uint64_t seen = 0;
+    for (;;)
+    {
+      auto job = std::shared_ptr<Job>();
+      {
+        auto lock = std::unique_lock(mx_);
+        cv_.wait(lock, [&]()
+                 { return stop_.load(std::memory_order_relaxed) || (job_ && job_->generation != seen); });
+        if (stop_.load(std::memory_order_relaxed))
+          return;
+        job = job_;
+      }
+      seen = job->generation;
+      render(*job);
+    }
+  }
+
+  void render(Job &job)
+  {
+    auto tile = Tile{};
+    for (;;)
+    {
+      auto i = job.next.fetch_add(1, std::memory_order_relaxed);
+      if (i >= job.order.size() * job.passes || stale(job))
+        return;
+      tile.index = job.order[i % job.order.size()];
+      tile.pass = static_cast<int>(i / job.order.size());
+      auto tx = tile.index % tilesX_;
+      auto ty = tile.index / tilesX_;
+      tile.generation = job.generation;
+      tile.rect = {tx * kTileSize, ty * kTileSize, std::min(kTileSize, w_ - tx * kTileSize), std::min(kTileSize, h_ - ty * kTileSize)};
+      tile.rgb.resize(3 * static_cast<std::size_t>(tile.rect.w) * tile.rect.h);
+      tile.samples = 0;
+      auto begin = std::chrono::steady_clock::now();
+      {
+        RTC_PROFILE_SCOPE("RenderService shade tile");
+        if (!shade(job, tile))
+          return;
+      }
+      tile.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+      RTC_PROFILE_COUNT("samples shaded", tile.samples);
+      // The UI drains once a frame, wait for room rather than drop work
+      while (!queue_.push(tile))
+      {
+        if (stale(job))
+          return;
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+      }
+    }
+  }
+
+  // Fills the tile with one sample from the middle of each scale x scale
+  // block, or the accumulated means when there are several passes. False if
+  // the job went stale on the way.
+  bool shade(const Job &job, Tile &tile) const
+  {
+    if (job.accum)
+      return accumulate(job, tile);
+    auto &r = tile.rect;
+    for (int by = r.y; by < r.y + r.h; by += job.scale)
+    {
+      if (stale(job))
+        return false;
+      auto bh = std::min(job.scale, r.y + r.h - by);
+      for (int bx = r.x; bx < r.x + r.w; bx += job.scale)
+      {
+        auto bw = std::min(job.scale, r.x + r.w - bx);
+        auto c = job.shader(bx + bw * T(0.5), by + bh * T(0.5));
+        tile.samples++;
+        for (int y = by; y < by + bh; y++)
+        {
+          auto out = tile.rgb.data() + 3 * (static_cast<std::size_t>(y - r.y) * r.w + (bx - r.x));
+          for (int x = 0; x < bw; x++, out += 3)
+          {
+            out[0] = c.r();
+            out[1] = c.g();
+            out[2] = c.b();
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  // Adds sample number `tile.pass` to each pixel of the tile and fills it
+  // with the means so far
+  bool accumulate(const Job &job, Tile &tile) const
+  {
+    auto &r = tile.rect;
+    auto offset = Sampling::SampleOffset(tile.pass);
+    auto out = tile.rgb.data();
+    for (int y = r.y; y < r.y + r.h; y++)
+    {
+      if (stale(job))
+        return false;
+      for (int x = r.x; x < r.x + r.w; x++, out += 3)
+      {
+        job.accum->addSample(job.shader(x + offset.first, y + offset.second), x, y);
+        auto c = job.accum->pixelAt(x, y);
+        out[0] = c.r();
+        out[1] = c.g();
+        out[2] = c.b();
+      }
+    }
+    tile.samples += static_cast<std::size_t>(r.w) * r.h;
+    return true;
+  }
+
+  int w_, h_;
+  int tilesX_, tilesY_;
+  unsigned threads_;
+
+  TileQueue<Tile> queue_;
+  std::atomic<uint64_t> generation_{0};
+  std::atomic<bool> stop_{false};
+
+  // Hands jobs to idle workers
+  std::mutex mx_;
+  std::condition_variable cv_;
+  std::shared_ptr<Job> job_;
+
+  // Only touched by the UI thread
+  std::size_t done_ = 0;
+  std::size_t total_ = 0;
+  Stats stats_;
+  // Newest pass drained for each tile
+  std::vector<int> tilePass_;
+  std::array<std::shared_ptr<AccumulationBuffer<T>>, 2> accums_;
+  // The current job's, null when it takes one sample per pixel
+  const AccumulationBuffer<T> *current_ = nullptr;
+
+  // Last, so the threads start after everything above exists and are
+  // joined before it goes away
+  Parallel::WorkerGroup workers_;
+};
+
+#endif // RENDER_SERVICE_H
@@ -0,0 +1,273 @@
+#ifndef STREAMING_CANVAS_H
+#define STREAMING_CANVAS_H
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spdlog/spdlog.h"
+
+#include "color.h"
+#include "app/canvas.h"
+#include "app/canvas_pool.h"
+#include "app/file_io.h"
+#include "app/ppm.h"
+#include "app/qoi.h"
+
+// A write-only canvas for images too large to hold in memory. Pixels go
+// into bands of rows, and a band is encoded to the file and released as
+// soon as it and every band above it are complete. Peak memory is the
+// bands in flight, not the image.
+//
+// Every pixel must be written exactly once; the band counts down its
+// pixels to know when it is done. A second write to a pixel, including
+// one into rows already written out, throws std::logic_error and keeps
+// the first value, so it can't complete a band early.
+//
+// writePixel() may be called from any number of threads. A render that
+// proceeds roughly top to bottom keeps only a few bands alive, one that
+// jumps around keeps every band it has touched until the rows above it
+// are done.
+template <typename T>
+requires std::floating_point<T>
+class StreamingCanvas
+{
+public:
+  StreamingCanvas(const std::string &filename, int w, int h, ImageFormat format = ImageFormat::PPM_P6, int bandRows = 16)
+      : out_(filename), format_{format}, w_{w}, h_{h}, bandRows_{bandRows},
+        bands_((h + bandRows - 1) / bandRows), users_(bands_.size()), p3_(w)
+  {
+    assert(w >= 0);
+    assert(h >= 0);
+    assert(bandRows > 0);
+    if (format_ == ImageFormat::QOI)
+      qoi_.emplace(out_, w_, h_);
+    else
+      out_.write(MakePPMHeader(format_, w_, h_));
+    quantized_.resize(3 * static_cast<std::size_t>(w_));
+    // Empty rows have no pixels to complete them
+    if (w_ == 0)
+      next_ = static_cast<int>(bands_.size());
+  }
+
+  ~StreamingCanvas()
+  {
+    try
+    {
+      close();
+    }
+    catch (const std::exception &e)
+    {
+      spdlog::error("StreamingCanvas: {}", e.what());
+    }
+    for (auto &band : bands_)
+      delete band.load(std::memory_order_relaxed);
+  }
+
+  StreamingCanvas(const StreamingCanvas &) = delete;
+  StreamingCanvas &operator=(const StreamingCanvas &) = delete;
+
+  int width() const { return w_; }
+  int height() const { return h_; }
+
+  void writePixel(Color::Color<T> c, int x, int y)
+  {
+    assert(x >= 0);
+    assert(x < w_);
+    assert(y >= 0);
+    assert(y < h_);
+    auto b = y / bandRows_;
+    bool complete;
+    {
+      auto user = BandUser(users_[b], x, y);
+      auto band = bandFor(b);
+      // Claim the pixel first, a second write must not count down the band
+      auto i = static_cast<std::size_t>(y - b * bandRows_) * w_ + x;
+      auto bit = uint64_t(1) << (i % 64);
+      if (band->written[i / 64].fetch_or(bit, std::memory_order_relaxed) & bit)
+        throw std::logic_error(AlreadyWritten(x, y));
+      band->pixels.writePixel(c, x, y - b * bandRows_);
+      complete = band->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+    // Outside the band, flushReady() waits for its writers to leave
+    if (complete)
+      flushReady();
+  }
+
+  // Rows encoded to the file so far
+  int rowsWritten() const
+  {
+    auto lock = std::lock_guard(flushMx_);
+    return std::min(h_, next_ * bandRows_);
+  }
+
+  // Bands allocated and not yet written out
+  std::size_t residentBands() const
+  {
+    return resident_.load(std::memory_order_relaxed);
+  }
+
+  // Finishes the file. Throws if rows are missing, the complete rows above
+  // them are written either way.
+  void close()
+  {
+    auto lock = std::lock_guard(flushMx_);
+    if (closed_)
+      return;
+    closed_ = true;
+    auto missing = h_ - std::min(h_, next_ * bandRows_);
+    if (missing == 0)
+    {
+      if (format_ == ImageFormat::PPM_P3)
+        out_.write("\n");
+      else if (format_ == ImageFormat::QOI)
+        qoi_->finish();
+    }
+    out_.close();
+    if (missing > 0)
+      throw std::runtime_error("StreamingCanvas closed with " + std::to_string(missing) + " unfinished rows");
+  }
+
+private:
+  struct Band
+  {
+    Canvas<T> pixels;
+    std::atomic<int64_t> remaining;
+    // One bit per pixel, set by its first write
+    std::unique_ptr<std::atomic<uint64_t>[]> written;
+  };
+
+  static std::string AlreadyWritten(int x, int y)
+  {
+    return "StreamingCanvas pixel (" + std::to_string(x) + ", " + std::to_string(y) + ") written twice";
+  }
+
+  // Set in a band's user count once it is complete
+  static constexpr uint32_t kRetired = uint32_t(1) << 31;
+
+  // Holds a band alive for one write. Throws if the band is already
+  // complete, every pixel in it has been written.
+  class BandUser
+  {
+  public:
+    BandUser(std::atomic<uint32_t> &users, int x, int y) : users_{users}
+    {
+      if (users_.fetch_add(1, std::memory_order_acquire) & kRetired)
+      {
+        users_.fetch_sub(1, std::memory_order_release);
+        throw std::logic_error(AlreadyWritten(x, y));
+      }
+    }
+
+    ~BandUser()
+    {
+      users_.fetch_sub(1, std::memory_order_release);
+    }
+
+    BandUser(const BandUser &) = delete;
+    BandUser &operator=(const BandUser &) = delete;
+
+  private:
+    std::atomic<uint32_t> &users_;
+  };
+
+  int rowsIn(int b) const
+  {
+    return std::min(bandRows_, h_ - b * bandRows_);
+  }
+
+  // Only called inside a BandUser, so the band can't be retired yet
+  Band *bandFor(int b)
+  {
+    auto band = bands_[b].load(std::memory_order_acquire);
+    if (band)
+      return band;
+    auto lock = std::lock_guard(allocMx_);
+    band = bands_[b].load(std::memory_order_relaxed);
+    if (!band)
+    {
+      auto rows = rowsIn(b);
+      auto pixels = static_cast<int64_t>(w_) * rows;
+      band = new Band{pool_.acquire(w_, rows), pixels, std::unique_ptr<std::atomic<uint64_t>[]>(new std::atomic<uint64_t>[(pixels + 63) / 64]())};
+      resident_.fetch_add(1, std::memory_order_relaxed);
+      bands_[b].store(band, std::memory_order_release);
+    }
+    return band;
+  }
+
+  // Writes out every complete band at the front, in order.
+  void flushReady()
+  {
+    auto lock = std::lock_guard(flushMx_);
+    while (!closed_ && next_ < static_cast<int>(bands_.size()))
+    {
+      auto band = bands_[next_].load(std::memory_order_acquire);
+      if (!band || band->remaining.load(std::memory_order_acquire) != 0)
+        break;
+      // No new writers get in, and the ones still inside are duplicates
+      // about to throw. Wait them out before freeing the band.
+      auto &users = users_[next_];
+      users.fetch_or(kRetired, std::memory_order_acq_rel);
+      while ((users.load(std::memory_order_acquire) & ~kRetired) != 0)
+        std::this_thread::yield();
+      auto rows = band->pixels.height();
+      for (int y = 0; y < rows; y++)
+        writeRow(band->pixels.data() + 3 * static_cast<std::size_t>(y) * w_);
+      pool_.release(std::move(band->pixels));
+      bands_[next_].store(nullptr, std::memory_order_relaxed);
+      delete band;
+      resident_.fetch_sub(1, std::memory_order_relaxed);
+      next_++;
+    }
+  }
+
+  void writeRow(const T *rgb)
+  {
+    switch (format_)
+    {
+    case ImageFormat::PPM_P3:
+      out_.write(p3_.encode(rgb));
+      break;
+    case ImageFormat::PPM_P6:
+      PPM::QuantizeRow(rgb, w_, quantized_.data());
+      out_.write(reinterpret_cast<const char *>(quantized_.data()), quantized_.size());
+      break;
+    case ImageFormat::QOI:
+      PPM::QuantizeRow(rgb, w_, quantized_.data());
+      qoi_->writeRow(quantized_.data(), w_);
+      break;
+    }
+  }
+
+  FileWriter out_;
+  ImageFormat format_;
+  int w_, h_;
+  int bandRows_;
+
+  std::vector<std::atomic<Band *>> bands_;
+  // Writers inside each band plus kRetired, kept for the canvas' whole
+  // life so a write racing a flush never touches a freed band
+  std::vector<std::atomic<uint32_t>> users_;
+  std::mutex allocMx_;
+  std::atomic<std::size_t> resident_{0};
+  // Finished bands come back for the next ones, so a top to bottom render
+  // allocates only a handful of band buffers in total
+  CanvasPool<T> pool_;
+
+  // Everything below is only touched under flushMx_
+  mutable std::mutex flushMx_;
+  int next_ = 0;
+  bool closed_ = false;
+  PPM::P3RowEncoder<T> p3_;
+  std::vector<uint8_t> quantized_;
+  std::optional<QOI::Encoder> qoi_;
+};
+
+#endif // STREAMING_CANVAS_H
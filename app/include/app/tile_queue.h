@@ -0,0 +1,107 @@
+#ifndef TILE_QUEUE_H
+#define TILE_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+
+// Bounded lock-free queue for handing finished work from render threads to
+// the UI thread (D. Vyukov's bounded MPMC queue). Any number of threads may
+// push(), pop() is meant for a single consumer. Neither ever blocks: push()
+// fails when the queue is full and pop() when it is empty.
+template <typename T>
+class TileQueue
+{
+public:
+  // Capacity is rounded up to a power of two
+  explicit TileQueue(std::size_t capacity = 64)
+  {
+    capacity_ = 2;
+    while (capacity_ < capacity)
+      capacity_ *= 2;
+    mask_ = capacity_ - 1;
+    cells_ = std::make_unique<Cell[]>(capacity_);
+    for (std::size_t i = 0; i < capacity_; i++)
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  TileQueue(const TileQueue &) = delete;
+  TileQueue &operator=(const TileQueue &) = delete;
+
+  std::size_t capacity() const { return capacity_; }
+
+  // Moves `v` in and returns true, or leaves it alone if the queue is full.
+  bool push(T &v)
+  {
+    auto pos = tail_.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      auto &cell = cells_[pos & mask_];
+      auto seq = cell.seq.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0)
+      {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          cell.value = std::move(v);
+          cell.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (diff < 0)
+      {
+        return false;
+      }
+      else
+      {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  std::optional<T> pop()
+  {
+    auto pos = head_.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      auto &cell = cells_[pos & mask_];
+      auto seq = cell.seq.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+      if (diff == 0)
+      {
+        if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          auto res = std::optional<T>(std::move(cell.value));
+          cell.seq.store(pos + capacity_, std::memory_order_release);
+          return res;
+        }
+      }
+      else if (diff < 0)
+      {
+        return std::nullopt;
+      }
+      else
+      {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+private:
+  struct Cell
+  {
+    std::atomic<std::size_t> seq;
+    T value;
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  std::size_t capacity_ = 0;
+  std::size_t mask_ = 0;
+  // Producers and the consumer each get their own cache line
+  alignas(64) std::atomic<std::size_t> tail_{0};
+  alignas(64) std::atomic<std::size_t> head_{0};
+};
+
+#endif // TILE_QUEUE_H
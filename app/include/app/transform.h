@@ -0,0 +1,100 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include "types.h"
+#include "app/matrix.h"
+
+namespace Matrix
+{
+  // Holds a forward transform and lazily caches its inverse and
+  // inverse-transpose. The cache is only dropped when the forward transform
+  // changes, so untouched objects never re-invert.
+  //
+  // The cache is filled on first access from a const method; call
+  // inverse() once before sharing a Transform between threads.
+  template <class T>
+  requires Number<T>
+  class Transform
+  {
+    Matrix4<T> forward_;
+    mutable Matrix4<T> inverse_;
+    mutable Matrix4<T> inverse_transpose_;
+    mutable bool cached_ = false;
+
+  public:
+    Transform() : forward_{Identity<T>()} {};
+    Transform(const Matrix4<T> &forward) : forward_{forward} {};
+
+    const Matrix4<T> &matrix() const
+    {
+      return forward_;
+    }
+
+    const Matrix4<T> &inverse() const
+    {
+      Cache();
+      return inverse_;
+    }
+
+    // For transforming normals back out of object space.
+    const Matrix4<T> &inverse_transpose() const
+    {
+      Cache();
+      return inverse_transpose_;
+    }
+
+    bool cached() const
+    {
+      return cached_;
+    }
+
+    Transform<T> &set(const Matrix4<T> &forward)
+    {
+      forward_ = forward;
+      cached_ = false;
+      return *this;
+    }
+
+    Transform<T> &translate(T x, T y, T z)
+    {
+      return set(forward_.translate(x, y, z));
+    }
+
+    Transform<T> &scale(T x, T y, T z)
+    {
+      return set(forward_.scale(x, y, z));
+    }
+
+    Transform<T> &rotate_x(T rads)
+    {
+      return set(forward_.rotate_x(rads));
+    }
+
+    Transform<T> &rotate_y(T rads)
+    {
+      return set(forward_.rotate_y(rads));
+    }
+
+    Transform<T> &rotate_z(T rads)
+    {
+      return set(forward_.rotate_z(rads));
+    }
+
+    Transform<T> &shear(T xy, T xz, T yx, T yz, T zx, T zy)
+    {
+      return set(forward_.shear(xy, xz, yx, yz, zx, zy));
+    }
+
+  private:
+    void Cache() const
+    {
+      if (cached_)
+        return;
+      inverse_ = forward_.inverse();
+      inverse_transpose_ = inverse_.t();
+      cached_ = true;
+    }
+  };
+} // End Matrix
+
+#endif // TRANSFORM_H
@@ -0,0 +1,103 @@
+#ifndef TRANSFORM_BATCH_H
+#define TRANSFORM_BATCH_H
+
+#include <cassert>
+#include <cstddef>
+
+#include "types.h"
+#include "math.h"
+#include "app/matrix.h"
+
+namespace Matrix
+{
+  // Structure-of-arrays view over `size` points or vectors, w is implied by
+  // the call (1 for points, 0 for vectors). Output may alias the input.
+  template <class T>
+  struct TupleSpan
+  {
+    T *x;
+    T *y;
+    T *z;
+    std::size_t size;
+  };
+
+  template <class T>
+  struct ConstTupleSpan
+  {
+    const T *x;
+    const T *y;
+    const T *z;
+    std::size_t size;
+
+    ConstTupleSpan(const T *x, const T *y, const T *z, std::size_t size)
+        : x{x}, y{y}, z{z}, size{size} {};
+    ConstTupleSpan(const TupleSpan<T> &s) : x{s.x}, y{s.y}, z{s.z}, size{s.size} {};
+  };
+
+  enum class SimdLevel
+  {
+    Scalar,
+    SSE2,
+    AVX2
+  };
+
+  // Best instruction set supported by the running CPU, detected once. This
+  // only chooses among the kernels, on top of whatever the build targets:
+  // with RTC_SIMD_TUPLE that is SSE4.1 already, so on x86 it picks SSE2 or
+  // AVX2 and Scalar is left to other architectures.
+  SimdLevel DetectSimd();
+
+  // Bottom row 0 0 0 1, so w passes through unchanged.
+  template <class T>
+  requires Number<T>
+  bool IsAffine(const Matrix4<T> &m)
+  {
+    return epsilon_eq(m(3, 0), 0) && epsilon_eq(m(3, 1), 0) && epsilon_eq(m(3, 2), 0) && epsilon_eq(m(3, 3), 1);
+  }
+
+  // Applies one transform to every element of `in`, writing to `out`.
+  // `level` is clamped to what the CPU supports.
+  //
+  // Spans have no w, so only the x, y and z rows are applied. Points take
+  // the translation column and `m` must be affine (asserted); projections
+  // need the full Matrix4 * Tuple path, which keeps w for the divide.
+  // Vectors only read the upper-left 3x3, so normals can go through
+  // TransformVectors with the inverse-transpose of a 4x4 whatever its
+  // bottom row.
+  void TransformPoints(const Matrix4<float> &m, ConstTupleSpan<float> in, TupleSpan<float> out,
+                       SimdLevel level = DetectSimd());
+  void TransformPoints(const Matrix4<double> &m, ConstTupleSpan<double> in, TupleSpan<double> out,
+                       SimdLevel level = DetectSimd());
+  void TransformVectors(const Matrix4<float> &m, ConstTupleSpan<float> in, TupleSpan<float> out,
+                        SimdLevel level = DetectSimd());
+  void TransformVectors(const Matrix4<double> &m, ConstTupleSpan<double> in, TupleSpan<double> out,
+                        SimdLevel level = DetectSimd());
+
+  // Portable kernel, also the tail loop of the SIMD paths.
+  template <class T, bool Point>
+  requires Number<T>
+  void TransformBatchScalar(const Matrix4<T> &m, ConstTupleSpan<T> in, TupleSpan<T> out,
+                            std::size_t begin = 0)
+  {
+    assert(in.size == out.size);
+    if constexpr (Point)
+      assert(IsAffine(m));
+    for (auto i = begin; i < in.size; i++)
+    {
+      auto x = in.x[i];
+      auto y = in.y[i];
+      auto z = in.z[i];
+      out.x[i] = m(0, 0) * x + m(0, 1) * y + m(0, 2) * z;
+      out.y[i] = m(1, 0) * x + m(1, 1) * y + m(1, 2) * z;
+      out.z[i] = m(2, 0) * x + m(2, 1) * y + m(2, 2) * z;
+      if constexpr (Point)
+      {
+        out.x[i] += m(0, 3);
+        out.y[i] += m(1, 3);
+        out.z[i] += m(2, 3);
+      }
+    }
+  }
+} // End Matrix
+
+#endif // TRANSFORM_BATCH_H
@@ -0,0 +1,239 @@
+#ifndef TRANSFORM_EXPR_H
+#define TRANSFORM_EXPR_H
+
+#include <type_traits>
+
+#include "types.h"
+#include "math.h"
+#include "app/matrix.h"
+
+namespace Matrix
+{
+  // Lazy transform chains.
+  //
+  //   Matrix4<double> m = Lazy<double>().rotate_x(a).scale(2, 2, 2).translate(x, y, z);
+  //
+  // Each builder call only records an op in the expression type. The chain
+  // is evaluated in a single pass when converted to a Matrix4: every op is
+  // applied in place as the few row updates it actually needs instead of a
+  // full 4x4 product. Consecutive translations, scalings and rotations about
+  // the same axis are folded into one op while the chain is built.
+  namespace Ops
+  {
+    template <class T>
+    struct Translate
+    {
+      T x, y, z;
+
+      constexpr Translate<T> fold(const Translate<T> &next) const
+      {
+        return {x + next.x, y + next.y, z + next.z};
+      }
+
+      constexpr void apply(Matrix4<T> &m) const
+      {
+        for (uint_fast32_t col = 0; col < 4; col++)
+        {
+          m(0, col) += x * m(3, col);
+          m(1, col) += y * m(3, col);
+          m(2, col) += z * m(3, col);
+        }
+      }
+    };
+
+    template <class T>
+    struct Scale
+    {
+      T x, y, z;
+
+      constexpr Scale<T> fold(const Scale<T> &next) const
+      {
+        return {x * next.x, y * next.y, z * next.z};
+      }
+
+      constexpr void apply(Matrix4<T> &m) const
+      {
+        for (uint_fast32_t col = 0; col < 4; col++)
+        {
+          m(0, col) *= x;
+          m(1, col) *= y;
+          m(2, col) *= z;
+        }
+      }
+    };
+
+    // Rotation about one axis, mixes rows A and B by [cos -sin; sin cos].
+    template <class T, uint_fast32_t A, uint_fast32_t B>
+    struct Rotate
+    {
+      T rads;
+
+      constexpr Rotate<T, A, B> fold(const Rotate<T, A, B> &next) const
+      {
+        return {rads + next.rads};
+      }
+
+      constexpr void apply(Matrix4<T> &m) const
+      {
+        T c = constexpr_cos(rads);
+        T s = constexpr_sin(rads);
+        for (uint_fast32_t col = 0; col < 4; col++)
+        {
+          auto a = m(A, col);
+          auto b = m(B, col);
+          m(A, col) = c * a - s * b;
+          m(B, col) = s * a + c * b;
+        }
+      }
+    };
+
+    template <class T>
+    using RotateX = Rotate<T, 1, 2>;
+    template <class T>
+    using RotateY = Rotate<T, 2, 0>;
+    template <class T>
+    using RotateZ = Rotate<T, 0, 1>;
+
+    template <class T>
+    struct Shear
+    {
+      T xy, xz, yx, yz, zx, zy;
+
+      constexpr void apply(Matrix4<T> &m) const
+      {
+        for (uint_fast32_t col = 0; col < 4; col++)
+        {
+          auto x = m(0, col);
+          auto y = m(1, col);
+          auto z = m(2, col);
+          m(0, col) = x + xy * y + xz * z;
+          m(1, col) = y + yx * x + yz * z;
+          m(2, col) = z + zx * x + zy * y;
+        }
+      }
+    };
+
+    template <class Op>
+    concept Foldable = requires(const Op &op) { op.fold(op); };
+  }
+
+  template <class T, class Prev, class Op>
+  class TransformExpr;
+
+  // Builder methods shared by every node of a chain.
+  template <class T, class Derived>
+  class TransformChain
+  {
+  public:
+    constexpr auto translate(T x, T y, T z) const
+    {
+      return Then(Ops::Translate<T>{x, y, z});
+    }
+
+    constexpr auto scale(T x, T y, T z) const
+    {
+      return Then(Ops::Scale<T>{x, y, z});
+    }
+
+    constexpr auto rotate_x(T rads) const
+    {
+      return Then(Ops::RotateX<T>{rads});
+    }
+
+    constexpr auto rotate_y(T rads) const
+    {
+      return Then(Ops::RotateY<T>{rads});
+    }
+
+    constexpr auto rotate_z(T rads) const
+    {
+      return Then(Ops::RotateZ<T>{rads});
+    }
+
+    constexpr auto shear(T xy, T xz, T yx, T yz, T zx, T zy) const
+    {
+      return Then(Ops::Shear<T>{xy, xz, yx, yz, zx, zy});
+    }
+
+    constexpr operator Matrix4<T>() const
+    {
+      return Self().eval();
+    }
+
+  private:
+    constexpr const Derived &Self() const
+    {
+      return static_cast<const Derived &>(*this);
+    }
+
+    template <class Op>
+    constexpr auto Then(const Op &op) const
+    {
+      if constexpr (std::is_same_v<typename Derived::op_type, Op> && Ops::Foldable<Op>)
+      {
+        return TransformExpr<T, typename Derived::prev_type, Op>(Self().prev(), Self().op().fold(op));
+      }
+      else
+      {
+        return TransformExpr<T, Derived, Op>(Self(), op);
+      }
+    }
+  };
+
+  // Start of a chain, either the identity or an existing matrix.
+  template <class T>
+  class TransformSeed : public TransformChain<T, TransformSeed<T>>
+  {
+    Matrix4<T> seed_;
+
+  public:
+    using op_type = void;
+
+    constexpr TransformSeed() : seed_{Identity<T>()} {};
+    constexpr TransformSeed(const Matrix4<T> &seed) : seed_{seed} {};
+
+    constexpr Matrix4<T> eval() const
+    {
+      return seed_;
+    }
+  };
+
+  template <class T, class Prev, class Op>
+  class TransformExpr : public TransformChain<T, TransformExpr<T, Prev, Op>>
+  {
+    Prev prev_;
+    Op op_;
+
+  public:
+    using prev_type = Prev;
+    using op_type = Op;
+
+    constexpr TransformExpr(const Prev &prev, const Op &op) : prev_{prev}, op_{op} {};
+
+    constexpr const Prev &prev() const { return prev_; }
+    constexpr const Op &op() const { return op_; }
+
+    constexpr Matrix4<T> eval() const
+    {
+      auto res = prev_.eval();
+      op_.apply(res);
+      return res;
+    }
+  };
+
+  template <class T>
+  requires Number<T>
+  constexpr TransformSeed<T> Lazy()
+  {
+    return TransformSeed<T>();
+  }
+
+  template <class T>
+  requires Number<T>
+  constexpr TransformSeed<T> Lazy(const Matrix4<T> &seed)
+  {
+    return TransformSeed<T>(seed);
+  }
+} // End Matrix
+
+#endif // TRANSFORM_EXPR_H
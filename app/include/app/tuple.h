@@ -46,7 +46,7 @@ namespace Tuple
 
     T magnitude() const
     {
-      return std::sqrt(x_ * x_ + y_ * y_ + z_ * z_ + w_ + w_);
+      return std::sqrt(x_ * x_ + y_ * y_ + z_ * z_ + w_ * w_);
     }
 
     Tuple<T> normalize() const
@@ -110,7 +110,12 @@ namespace Tuple
       return Tuple(x_ / div, y_ / div, z_ / div, w_ / div);
     }
   };
+}
+
+#include "app/tuple_simd.h"
 
+namespace Tuple
+{
   template <typename T>
   requires Number<T>
   auto operator*(T scalar, const Tuple<T> t)
@@ -118,6 +123,19 @@ namespace Tuple
     return t * scalar;
   }
 
+  // Transforms a point or vector in registers, without going through the
+  // Matrix conversion above.
+  template <typename T>
+  requires Number<T>
+  Tuple<T> operator*(const Matrix::Matrix4<T> &m, const Tuple<T> &t)
+  {
+    const T *a = m.data();
+    return Tuple<T>(a[0] * t.x() + a[1] * t.y() + a[2] * t.z() + a[3] * t.w(),
+                    a[4] * t.x() + a[5] * t.y() + a[6] * t.z() + a[7] * t.w(),
+                    a[8] * t.x() + a[9] * t.y() + a[10] * t.z() + a[11] * t.w(),
+                    a[12] * t.x() + a[13] * t.y() + a[14] * t.z() + a[15] * t.w());
+  }
+
   auto Point(auto x, auto y, auto z)
   {
     return Tuple(x, y, z, static_cast<decltype(x)>(1.0));
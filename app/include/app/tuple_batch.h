@@ -0,0 +1,237 @@
+#ifndef TUPLES_BATCH_H
+#define TUPLES_BATCH_H
+
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+
+#include "math.h"
+#include "types.h"
+#include "app/tuple.h"
+
+namespace Tuple
+{
+  // Active lanes of a TupleBatch operation, lanes left false keep their
+  // previous value (and are never divided by zero in normalize()).
+  template <std::size_t N>
+  using LaneMask = std::array<bool, N>;
+
+  template <std::size_t N>
+  constexpr LaneMask<N> AllLanes()
+  {
+    LaneMask<N> mask;
+    mask.fill(true);
+    return mask;
+  }
+
+  // N points/vectors stored structure-of-arrays, one aligned array per
+  // component, for packets of coherent rays and vectorized shading. Every
+  // operation is a plain loop over the lanes that the compiler vectorizes.
+  template <typename T, std::size_t N>
+  requires Number<T> &&(N == 4 || N == 8 || N == 16)
+  class TupleBatch
+  {
+    using Lanes = std::array<T, N>;
+
+    alignas(64) Lanes x_{};
+    alignas(64) Lanes y_{};
+    alignas(64) Lanes z_{};
+    alignas(64) Lanes w_{};
+
+  public:
+    static constexpr std::size_t size() { return N; }
+
+    TupleBatch() = default;
+
+    // The same tuple in every lane
+    static TupleBatch<T, N> Broadcast(const Tuple<T> &t)
+    {
+      auto res = TupleBatch<T, N>();
+      res.x_.fill(t.x());
+      res.y_.fill(t.y());
+      res.z_.fill(t.z());
+      res.w_.fill(t.w());
+      return res;
+    }
+
+    // Loads `count` tuples into the first lanes, the rest stay zero
+    static TupleBatch<T, N> Gather(const Tuple<T> *src, std::size_t count = N)
+    {
+      assert(count <= N);
+      auto res = TupleBatch<T, N>();
+      for (std::size_t i = 0; i < count; i++)
+      {
+        res.set(i, src[i]);
+      }
+      return res;
+    }
+
+    void Scatter(Tuple<T> *dst, std::size_t count = N) const
+    {
+      assert(count <= N);
+      for (std::size_t i = 0; i < count; i++)
+      {
+        dst[i] = at(i);
+      }
+    }
+
+    Tuple<T> at(std::size_t lane) const
+    {
+      assert(lane < N);
+      return Tuple<T>(x_[lane], y_[lane], z_[lane], w_[lane]);
+    }
+
+    void set(std::size_t lane, const Tuple<T> &t)
+    {
+      assert(lane < N);
+      x_[lane] = t.x();
+      y_[lane] = t.y();
+      z_[lane] = t.z();
+      w_[lane] = t.w();
+    }
+
+    Lanes &x() { return x_; }
+    Lanes &y() { return y_; }
+    Lanes &z() { return z_; }
+    Lanes &w() { return w_; }
+    const Lanes &x() const { return x_; }
+    const Lanes &y() const { return y_; }
+    const Lanes &z() const { return z_; }
+    const Lanes &w() const { return w_; }
+
+    TupleBatch<T, N> add(const TupleBatch<T, N> &rhs, const LaneMask<N> &mask = AllLanes<N>()) const
+    {
+      auto res = *this;
+      for (std::size_t i = 0; i < N; i++)
+      {
+        res.x_[i] = mask[i] ? x_[i] + rhs.x_[i] : x_[i];
+        res.y_[i] = mask[i] ? y_[i] + rhs.y_[i] : y_[i];
+        res.z_[i] = mask[i] ? z_[i] + rhs.z_[i] : z_[i];
+        res.w_[i] = mask[i] ? w_[i] + rhs.w_[i] : w_[i];
+      }
+      return res;
+    }
+
+    TupleBatch<T, N> sub(const TupleBatch<T, N> &rhs, const LaneMask<N> &mask = AllLanes<N>()) const
+    {
+      auto res = *this;
+      for (std::size_t i = 0; i < N; i++)
+      {
+        res.x_[i] = mask[i] ? x_[i] - rhs.x_[i] : x_[i];
+        res.y_[i] = mask[i] ? y_[i] - rhs.y_[i] : y_[i];
+        res.z_[i] = mask[i] ? z_[i] - rhs.z_[i] : z_[i];
+        res.w_[i] = mask[i] ? w_[i] - rhs.w_[i] : w_[i];
+      }
+      return res;
+    }
+
+    // Per-lane scale factors, e.g. ray origin + t * direction
+    TupleBatch<T, N> scale(const Lanes &s, const LaneMask<N> &mask = AllLanes<N>()) const
+    {
+      auto res = *this;
+      for (std::size_t i = 0; i < N; i++)
+      {
+        res.x_[i] = mask[i] ? x_[i] * s[i] : x_[i];
+        res.y_[i] = mask[i] ? y_[i] * s[i] : y_[i];
+        res.z_[i] = mask[i] ? z_[i] * s[i] : z_[i];
+        res.w_[i] = mask[i] ? w_[i] * s[i] : w_[i];
+      }
+      return res;
+    }
+
+    TupleBatch<T, N> scale(T s, const LaneMask<N> &mask = AllLanes<N>()) const
+    {
+      Lanes lanes;
+      lanes.fill(s);
+      return scale(lanes, mask);
+    }
+
+    Lanes dot(const TupleBatch<T, N> &rhs) const
+    {
+      Lanes res;
+      for (std::size_t i = 0; i < N; i++)
+      {
+        res[i] = x_[i] * rhs.x_[i] + y_[i] * rhs.y_[i] + z_[i] * rhs.z_[i] + w_[i] * rhs.w_[i];
+      }
+      return res;
+    }
+
+    Lanes magnitude() const
+    {
+      auto res = dot(*this);
+      for (std::size_t i = 0; i < N; i++)
+      {
+        res[i] = std::sqrt(res[i]);
+      }
+      return res;
+    }
+
+    TupleBatch<T, N> normalize(const LaneMask<N> &mask = AllLanes<N>()) const
+    {
+      auto mag = magnitude();
+      Lanes inv;
+      for (std::size_t i = 0; i < N; i++)
+      {
+        inv[i] = mask[i] ? static_cast<T>(1) / mag[i] : static_cast<T>(1);
+      }
+      return scale(inv, mask);
+    }
+
+    // Lanes are treated as vectors, w of the result is 0
+    TupleBatch<T, N> cross(const TupleBatch<T, N> &rhs, const LaneMask<N> &mask = AllLanes<N>()) const
+    {
+      auto res = *this;
+      for (std::size_t i = 0; i < N; i++)
+      {
+        res.x_[i] = mask[i] ? y_[i] * rhs.z_[i] - z_[i] * rhs.y_[i] : x_[i];
+        res.y_[i] = mask[i] ? z_[i] * rhs.x_[i] - x_[i] * rhs.z_[i] : y_[i];
+        res.z_[i] = mask[i] ? x_[i] * rhs.y_[i] - y_[i] * rhs.x_[i] : z_[i];
+        res.w_[i] = mask[i] ? static_cast<T>(0) : w_[i];
+      }
+      return res;
+    }
+
+    TupleBatch<T, N> operator+(const TupleBatch<T, N> &rhs) const
+    {
+      return add(rhs);
+    }
+
+    TupleBatch<T, N> operator-(const TupleBatch<T, N> &rhs) const
+    {
+      return sub(rhs);
+    }
+
+    TupleBatch<T, N> operator*(T s) const
+    {
+      return scale(s);
+    }
+
+    bool operator==(const TupleBatch<T, N> &rhs) const
+    {
+      for (std::size_t i = 0; i < N; i++)
+      {
+        if (!(at(i) == rhs.at(i)))
+          return false;
+      }
+      return true;
+    }
+  };
+
+  // Picks lanes from `a` where the mask is set and from `b` elsewhere
+  template <typename T, std::size_t N>
+  TupleBatch<T, N> Select(const LaneMask<N> &mask, const TupleBatch<T, N> &a, const TupleBatch<T, N> &b)
+  {
+    auto res = TupleBatch<T, N>();
+    for (std::size_t i = 0; i < N; i++)
+    {
+      res.x()[i] = mask[i] ? a.x()[i] : b.x()[i];
+      res.y()[i] = mask[i] ? a.y()[i] : b.y()[i];
+      res.z()[i] = mask[i] ? a.z()[i] : b.z()[i];
+      res.w()[i] = mask[i] ? a.w()[i] : b.w()[i];
+    }
+    return res;
+  }
+}
+
+#endif // TUPLES_BATCH_H
@@ -0,0 +1,219 @@
+#ifndef TUPLES_SIMD_H
+#define TUPLES_SIMD_H
+
+// SIMD specializations of Tuple::Tuple, included from tuple.h.
+//
+// Tuple<float> keeps x/y/z/w in one SSE register when built with
+// RTC_SIMD_TUPLE and SSE4.1, Tuple<double> uses one AVX register when AVX
+// is enabled as well. Without them the portable scalar Tuple is used.
+
+#if defined(RTC_SIMD_TUPLE) && defined(__SSE4_1__)
+#include <immintrin.h>
+
+namespace Tuple
+{
+  template <>
+  class Tuple<float>
+  {
+    __m128 v_;
+
+    explicit Tuple(__m128 v) : v_{v} {};
+
+    float Lane(int i) const
+    {
+      alignas(16) float lanes[4];
+      _mm_store_ps(lanes, v_);
+      return lanes[i];
+    }
+
+  public:
+    Tuple(float x, float y, float z, float w) : v_{_mm_setr_ps(x, y, z, w)} {};
+    Tuple() : v_{_mm_setzero_ps()} {};
+
+    float x() const { return _mm_cvtss_f32(v_); }
+    float y() const { return Lane(1); }
+    float z() const { return Lane(2); }
+    float w() const { return Lane(3); }
+
+    bool IsPoint() const
+    {
+      return epsilon_eq(w(), 1.0);
+    }
+
+    bool IsVector() const
+    {
+      return epsilon_eq(w(), 0.0);
+    }
+
+    float magnitude() const
+    {
+      return _mm_cvtss_f32(_mm_sqrt_ss(_mm_dp_ps(v_, v_, 0xF1)));
+    }
+
+    Tuple<float> normalize() const
+    {
+      return Tuple(_mm_div_ps(v_, _mm_sqrt_ps(_mm_dp_ps(v_, v_, 0xFF))));
+    }
+
+    float dot(Tuple<float> rhs) const
+    {
+      return _mm_cvtss_f32(_mm_dp_ps(v_, rhs.v_, 0xF1));
+    }
+
+    // w of the result is a.w * b.w - a.w * b.w, i.e. 0 like Vector()
+    Tuple<float> cross(Tuple<float> rhs) const
+    {
+      auto a_yzx = _mm_shuffle_ps(v_, v_, _MM_SHUFFLE(3, 0, 2, 1));
+      auto a_zxy = _mm_shuffle_ps(v_, v_, _MM_SHUFFLE(3, 1, 0, 2));
+      auto b_yzx = _mm_shuffle_ps(rhs.v_, rhs.v_, _MM_SHUFFLE(3, 0, 2, 1));
+      auto b_zxy = _mm_shuffle_ps(rhs.v_, rhs.v_, _MM_SHUFFLE(3, 1, 0, 2));
+      return Tuple(_mm_sub_ps(_mm_mul_ps(a_yzx, b_zxy), _mm_mul_ps(a_zxy, b_yzx)));
+    }
+
+    operator Matrix::Matrix<float>() const
+    {
+      return Matrix::Matrix<float>({{x()}, {y()}, {z()}, {w()}});
+    }
+
+    bool operator==(const Tuple<float> rhs) const
+    {
+      auto diff = _mm_andnot_ps(_mm_set1_ps(-0.0f), _mm_sub_ps(v_, rhs.v_));
+      return _mm_movemask_ps(_mm_cmplt_ps(diff, _mm_set1_ps(EPSILON))) == 0xF;
+    }
+
+    auto operator+(const Tuple<float> rhs) const
+    {
+      return Tuple(_mm_add_ps(v_, rhs.v_));
+    }
+
+    auto operator-(const Tuple<float> rhs) const
+    {
+      return Tuple(_mm_sub_ps(v_, rhs.v_));
+    }
+
+    auto operator-() const
+    {
+      return Tuple(_mm_xor_ps(v_, _mm_set1_ps(-0.0f)));
+    }
+
+    auto operator*(float scalar) const
+    {
+      return Tuple(_mm_mul_ps(v_, _mm_set1_ps(scalar)));
+    }
+
+    auto operator/(float div) const
+    {
+      return Tuple(_mm_div_ps(v_, _mm_set1_ps(div)));
+    }
+  };
+
+#if defined(__AVX__)
+  template <>
+  class Tuple<double>
+  {
+    __m256d v_;
+
+    explicit Tuple(__m256d v) : v_{v} {};
+
+    double Lane(int i) const
+    {
+      alignas(32) double lanes[4];
+      _mm256_store_pd(lanes, v_);
+      return lanes[i];
+    }
+
+    static double Sum(__m256d v)
+    {
+      auto pair = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+      return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+    }
+
+  public:
+    Tuple(double x, double y, double z, double w) : v_{_mm256_setr_pd(x, y, z, w)} {};
+    Tuple() : v_{_mm256_setzero_pd()} {};
+
+    double x() const { return _mm256_cvtsd_f64(v_); }
+    double y() const { return Lane(1); }
+    double z() const { return Lane(2); }
+    double w() const { return Lane(3); }
+
+    bool IsPoint() const
+    {
+      return epsilon_eq(w(), 1.0);
+    }
+
+    bool IsVector() const
+    {
+      return epsilon_eq(w(), 0.0);
+    }
+
+    double magnitude() const
+    {
+      return std::sqrt(dot(*this));
+    }
+
+    Tuple<double> normalize() const
+    {
+      return Tuple(_mm256_div_pd(v_, _mm256_set1_pd(magnitude())));
+    }
+
+    double dot(Tuple<double> rhs) const
+    {
+      return Sum(_mm256_mul_pd(v_, rhs.v_));
+    }
+
+    // AVX has no cheap cross-lane permute for doubles, go through memory
+    Tuple<double> cross(Tuple<double> rhs) const
+    {
+      alignas(32) double a[4];
+      alignas(32) double b[4];
+      _mm256_store_pd(a, v_);
+      _mm256_store_pd(b, rhs.v_);
+      return Tuple(a[1] * b[2] - a[2] * b[1],
+                   a[2] * b[0] - a[0] * b[2],
+                   a[0] * b[1] - a[1] * b[0],
+                   0.0);
+    }
+
+    operator Matrix::Matrix<double>() const
+    {
+      return Matrix::Matrix<double>({{x()}, {y()}, {z()}, {w()}});
+    }
+
+    bool operator==(const Tuple<double> rhs) const
+    {
+      auto diff = _mm256_andnot_pd(_mm256_set1_pd(-0.0), _mm256_sub_pd(v_, rhs.v_));
+      return _mm256_movemask_pd(_mm256_cmp_pd(diff, _mm256_set1_pd(EPSILON), _CMP_LT_OQ)) == 0xF;
+    }
+
+    auto operator+(const Tuple<double> rhs) const
+    {
+      return Tuple(_mm256_add_pd(v_, rhs.v_));
+    }
+
+    auto operator-(const Tuple<double> rhs) const
+    {
+      return Tuple(_mm256_sub_pd(v_, rhs.v_));
+    }
+
+    auto operator-() const
+    {
+      return Tuple(_mm256_xor_pd(v_, _mm256_set1_pd(-0.0)));
+    }
+
+    auto operator*(double scalar) const
+    {
+      return Tuple(_mm256_mul_pd(v_, _mm256_set1_pd(scalar)));
+    }
+
+    auto operator/(double div) const
+    {
+      return Tuple(_mm256_div_pd(v_, _mm256_set1_pd(div)));
+    }
+  };
+#endif // __AVX__
+}
+
+#endif // RTC_SIMD_TUPLE && __SSE4_1__
+
+#endif // TUPLES_SIMD_H
@@ -0,0 +1,263 @@
+#include "app/file_io.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "spdlog/spdlog.h"
+
+namespace
+{
+  void WriteAll(int fd, const char *data, std::size_t size)
+  {
+    while (size > 0)
+    {
+      auto written = ::write(fd, data, size);
+      if (written < 0)
+      {
+        if (errno == EINTR)
+          continue;
+        throw std::runtime_error(std::string("write failed: ") + std::strerror(errno));
+      }
+      data += written;
+      size -= written;
+    }
+  }
+}
+
+FileWriter::FileWriter(const std::string &filename)
+    : fd_{::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)},
+      buffer_{new char[kBufferSize]}
+{
+  if (fd_ < 0)
+    throw std::runtime_error("Could not open " + filename + ": " + std::strerror(errno));
+  struct stat st;
+  seekable_ = ::fstat(fd_, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+FileWriter::~FileWriter()
+{
+  try
+  {
+    close();
+  }
+  catch (const std::exception &e)
+  {
+    spdlog::error("FileWriter: {}", e.what());
+  }
+}
+
+void FileWriter::write(const char *data, std::size_t size)
+{
+  offset_ += size;
+  if (used_ + size > kBufferSize)
+  {
+    flush();
+    // Large blocks skip the buffer entirely
+    if (size >= kBufferSize)
+    {
+      WriteAll(fd_, data, size);
+      return;
+    }
+  }
+  std::memcpy(buffer_.get() + used_, data, size);
+  used_ += size;
+}
+
+std::size_t FileWriter::reserve(std::size_t size)
+{
+  flush();
+  auto start = offset_;
+  offset_ += size;
+  if (::lseek(fd_, offset_, SEEK_SET) < 0)
+    throw std::runtime_error(std::string("lseek failed: ") + std::strerror(errno));
+  return start;
+}
+
+void FileWriter::writeAt(const char *data, std::size_t size, std::size_t offset)
+{
+  while (size > 0)
+  {
+    auto written = ::pwrite(fd_, data, size, offset);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      throw std::runtime_error(std::string("pwrite failed: ") + std::strerror(errno));
+    }
+    data += written;
+    size -= written;
+    offset += written;
+  }
+}
+
+void FileWriter::flush()
+{
+  if (used_ == 0)
+    return;
+  // Drop the buffered bytes even on failure so close() can't rethrow them
+  auto size = used_;
+  used_ = 0;
+  WriteAll(fd_, buffer_.get(), size);
+}
+
+void FileWriter::close()
+{
+  if (fd_ < 0)
+    return;
+  auto fd = fd_;
+  try
+  {
+    flush();
+  }
+  catch (...)
+  {
+    fd_ = -1;
+    ::close(fd);
+    throw;
+  }
+  fd_ = -1;
+  if (::close(fd) != 0)
+    throw std::runtime_error(std::string("close failed: ") + std::strerror(errno));
+}
+
+FileReader::FileReader(const std::string &filename)
+    : fd_{::open(filename.c_str(), O_RDONLY)},
+      buffer_{new char[kBufferSize]}
+{
+  if (fd_ < 0)
+    throw std::runtime_error("Could not open " + filename + ": " + std::strerror(errno));
+}
+
+FileReader::~FileReader()
+{
+  ::close(fd_);
+}
+
+bool FileReader::refill()
+{
+  pos_ = 0;
+  end_ = 0;
+  for (;;)
+  {
+    auto got = ::read(fd_, buffer_.get(), kBufferSize);
+    if (got < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      throw std::runtime_error(std::string("read failed: ") + std::strerror(errno));
+    }
+    end_ = got;
+    return got > 0;
+  }
+}
+
+std::string_view FileReader::buffered()
+{
+  if (pos_ == end_)
+    refill();
+  return std::string_view(buffer_.get() + pos_, end_ - pos_);
+}
+
+std::size_t FileReader::read(char *data, std::size_t size)
+{
+  std::size_t done = 0;
+  while (done < size)
+  {
+    auto buf = buffered();
+    if (buf.empty())
+      break;
+    auto n = std::min(buf.size(), size - done);
+    std::memcpy(data + done, buf.data(), n);
+    consume(n);
+    done += n;
+  }
+  return done;
+}
+
+MappedFile::MappedFile(const std::string &filename)
+{
+  auto fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("Could not open " + filename + ": " + std::strerror(errno));
+  struct stat st;
+  if (::fstat(fd, &st) != 0)
+  {
+    auto err = errno;
+    ::close(fd);
+    throw std::runtime_error("Could not stat " + filename + ": " + std::strerror(err));
+  }
+  size_ = st.st_size;
+  // mmap refuses empty mappings, an empty file is just an empty view
+  if (size_ > 0)
+  {
+    auto addr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED)
+    {
+      auto err = errno;
+      ::close(fd);
+      throw std::runtime_error("Could not map " + filename + ": " + std::strerror(err));
+    }
+    ::madvise(addr, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const char *>(addr);
+  }
+  ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+  if (data_)
+    ::munmap(const_cast<char *>(data_), size_);
+}
+
+MappedRegion::MappedRegion(const std::string &filename, std::size_t size) : size_{size}
+{
+  auto fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    throw std::runtime_error("Could not open " + filename + ": " + std::strerror(errno));
+  auto fail = [fd, &filename](const std::string &what)
+  {
+    auto err = errno;
+    ::close(fd);
+    throw std::runtime_error(what + " " + filename + ": " + std::strerror(err));
+  };
+  struct stat st;
+  if (::fstat(fd, &st) != 0)
+    fail("Could not stat");
+  created_ = st.st_size == 0;
+  if (created_)
+  {
+    if (::ftruncate(fd, size_) != 0)
+      fail("Could not size");
+  }
+  else if (static_cast<std::size_t>(st.st_size) != size_)
+  {
+    ::close(fd);
+    throw std::runtime_error(filename + " has size " + std::to_string(st.st_size) + ", expected " + std::to_string(size_));
+  }
+  if (size_ > 0)
+  {
+    auto addr = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED)
+      fail("Could not map");
+    data_ = static_cast<char *>(addr);
+  }
+  ::close(fd);
+}
+
+MappedRegion::~MappedRegion()
+{
+  if (data_)
+    ::munmap(data_, size_);
+}
+
+void MappedRegion::sync()
+{
+  if (data_ && ::msync(data_, size_, MS_SYNC) != 0)
+    throw std::runtime_error(std::string("msync failed: ") + std::strerror(errno));
+}
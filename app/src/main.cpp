@@ -2,6 +2,8 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <memory>
 
 #include "spdlog/spdlog.h"
 #include "imgui.h"
@@ -11,8 +13,14 @@
 #include <GLFW/glfw3.h> // Must happen after OpenGL init
 
 #include "app/math.h"
+#include "app/adaptive_resolution.h"
 #include "app/canvas.h"
 #include "app/color.h"
+#include "app/demo_scene.h"
+#include "app/perf_panel.h"
+#include "app/preview_texture.h"
+#include "app/profiler.h"
+#include "app/render_service.h"
 
 constexpr int canvas_width = 500;
 constexpr int canvas_height = 500;
@@ -28,6 +36,11 @@ int main(int, char **)
 {
   spdlog::info("Program Starting!");
   auto canvas = Canvas<float>(canvas_width, canvas_height);
+  // Workers shade the scene, the loop below only picks up finished tiles
+  auto renderer = RenderService<float>(canvas_width, canvas_height);
+  RenderService<float>::Shader shader;
+  // Coarse while the controls move, refined once they stop
+  auto resolution = AdaptiveResolution(canvas_width, canvas_height, 30.0, renderer.threads());
   // Setup window
   glfwSetErrorCallback(glfw_error_callback);
   if (!glfwInit())
@@ -82,15 +95,17 @@ int main(int, char **)
   static float color[4] = {1.0f, 1.0f, 1.0f, 1.0f};
 
   // Init Texture
-  GLuint texture_id_;
-  glGenTextures(1, &texture_id_);
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
+  // Owns GL objects, so it has to go before the context does
+  auto preview = std::make_unique<PreviewTexture>(canvas_width, canvas_height);
 
   ImVec2 uv_min = ImVec2(0.0f, 0.0f);                 // Top-left
   ImVec2 uv_max = ImVec2(1.0f, 1.0f);                 // Lower-right
   ImVec4 tint_col = ImVec4(1.0f, 1.0f, 1.0f, 1.0f);   // No tint
   ImVec4 border_col = ImVec4(1.0f, 1.0f, 1.0f, 0.5f); // 50% opaque white
 
+  auto perf = PerfPanel();
+  auto frame_start = std::chrono::steady_clock::now();
+
   while (!glfwWindowShouldClose(window))
   {
     glfwPollEvents();
@@ -105,36 +120,79 @@ int main(int, char **)
     // render your GUI
     ImGui::Begin("Point Position/Color");
     static float translation[] = {0.0, 0.0};
-    ImGui::SliderFloat2("position", translation, -1.0, 1.0);
+    static bool first_frame = true;
+    bool changed = ImGui::SliderFloat2("position", translation, -1.0, 1.0);
     // color picker
-    ImGui::ColorEdit3("color", color);
+    changed |= ImGui::ColorEdit3("color", color);
+    changed |= ImGui::Button("Restart");
+    ImGui::SameLine();
+    if (ImGui::Button("Cancel"))
+      renderer.cancel();
+    static float target_fps = 30.f;
+    if (ImGui::SliderFloat("target fps", &target_fps, 5.f, 120.f))
+      resolution.setTargetFps(target_fps);
+    // Per pixel at full resolution, used from the next image started
+    static int samples = 16;
+    ImGui::SliderInt("samples", &samples, 1, 256);
+    ImGui::Text("Resolution 1/%d, tiles %zu / %zu", resolution.scale(), renderer.tilesDone(), renderer.tileCount());
     ImGui::End();
 
-    // Update Canvas
-    auto w = std::clamp((int)((canvas_width / 2) + (translation[0] * (canvas_width / 2))), 0, canvas_width - 1);
-    auto h = std::clamp((int)((canvas_height / 2) + (translation[1] * (canvas_height / 2))), 0, canvas_height - 1);
-    canvas.writePixel(Color::Color(color[0], color[1], color[2]), w, h);
+    // Update Canvas, abandoning the old image whenever the scene changes
+    auto stats = RenderService<float>::Stats{};
+    {
+      RTC_PROFILE_SCOPE("canvas update");
+      if (changed || first_frame)
+      {
+        auto scene = SphereScene{translation[0], translation[1]};
+        scene.color = Color::Color<float>(color[0], color[1], color[2]);
+        shader = [scene](float u, float v)
+        { return scene.shade(u, v, canvas_width, canvas_height); };
+        renderer.start(shader, resolution.restart(), samples);
+      }
+      else if (renderer.finished() && renderer.tileCount() > 0)
+      {
+        // The input settled and the last pass is complete, sharpen it
+        if (auto scale = resolution.refine())
+          renderer.start(shader, scale, samples);
+      }
+      first_frame = false;
+      renderer.drain(canvas);
+      stats = renderer.takeStats();
+      resolution.measured(stats.samples, stats.seconds);
+    }
     // Render Texture - Canvas Window
     ImGui::Begin("Preview");
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, canvas.width(), canvas.height(), 0, GL_RGB, GL_FLOAT, canvas.data());
-    glGenerateMipmap(GL_TEXTURE_2D);
-    ImGui::Image((void *)(intptr_t)texture_id_, ImVec2(canvas.width(), canvas.height()), uv_min, uv_max, tint_col, border_col);
+    {
+      RTC_PROFILE_SCOPE("texture upload");
+      preview->update(canvas);
+    }
+    ImGui::Image((void *)(intptr_t)preview->id(), ImVec2(canvas.width(), canvas.height()), uv_min, uv_max, tint_col, border_col);
     ImGui::End();
 
+    perf.draw();
+
     // Render dear imgui into screen
-    ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    {
+      RTC_PROFILE_SCOPE("ui render");
+      ImGui::Render();
+      ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    }
 
     int display_w, display_h;
     glfwGetFramebufferSize(window, &display_w, &display_h);
     glViewport(0, 0, display_w, display_h);
-    glfwSwapBuffers(window);
-
-    // Clear
-    canvas.writePixel(Color::Color(0.f, 0.f, 0.f), w, h);
+    {
+      RTC_PROFILE_SCOPE("swap");
+      glfwSwapBuffers(window);
+    }
+
+    auto frame_end = std::chrono::steady_clock::now();
+    perf.frame(std::chrono::duration<double>(frame_end - frame_start).count(), stats.samples, preview->lastUploadBytes());
+    frame_start = frame_end;
   }
 
   // Cleanup
+  preview.reset();
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
@@ -0,0 +1,81 @@
+#include "app/perf_panel.h"
+
+#include <algorithm>
+
+#include "imgui.h"
+
+#include "app/canvas_buffer.h"
+#include "app/profiler.h"
+
+namespace
+{
+  constexpr double kMiB = 1024.0 * 1024.0;
+  // Weight of the newest frame in the smoothed throughput
+  constexpr double kSmoothing = 0.1;
+}
+
+void PerfPanel::frame(double seconds, std::size_t samples, std::size_t uploadBytes)
+{
+  frameMs_[next_] = static_cast<float>(seconds * 1000.0);
+  next_ = (next_ + 1) % kHistory;
+  filled_ = std::min(filled_ + 1, kHistory);
+  if (seconds > 0)
+    samplesPerSecond_ += kSmoothing * (samples / seconds - samplesPerSecond_);
+  uploadBytes_ = uploadBytes;
+  Profiling::Profiler::Instance().endFrame(seconds);
+}
+
+void PerfPanel::draw() const
+{
+  ImGui::Begin("Performance");
+
+  float last = 0.f, sum = 0.f, worst = 0.f;
+  if (filled_ > 0)
+    last = frameMs_[(next_ + kHistory - 1) % kHistory];
+  for (auto ms : frameMs_)
+  {
+    sum += ms;
+    worst = std::max(worst, ms);
+  }
+  auto average = filled_ > 0 ? sum / filled_ : 0.f;
+  ImGui::Text("Frame %.2f ms, average %.2f ms (%.0f fps)", last, average, average > 0 ? 1000.f / average : 0.f);
+  // Scaled so a 30 fps frame is always on the chart
+  ImGui::PlotHistogram("##frame_ms", frameMs_.data(), kHistory, next_, "frame ms", 0.f, std::max(worst, 33.3f), ImVec2(0, 60));
+
+  ImGui::Text("Samples/s: %.3g", samplesPerSecond_);
+  ImGui::Text("Preview upload: %.1f KiB", uploadBytes_ / 1024.0);
+  ImGui::Text("Canvas memory: %.1f MiB heap, %.1f MiB mapped", CanvasMemory::HeapBytes() / kMiB, CanvasMemory::MappedBytes() / kMiB);
+
+  ImGui::Separator();
+#if defined(RTC_PROFILING)
+  auto &profiler = Profiling::Profiler::Instance();
+  ImGui::Columns(4, "stages");
+  ImGui::Text("Stage");
+  ImGui::NextColumn();
+  ImGui::Text("ms");
+  ImGui::NextColumn();
+  ImGui::Text("avg ms");
+  ImGui::NextColumn();
+  ImGui::Text("calls");
+  ImGui::NextColumn();
+  ImGui::Separator();
+  for (auto &stage : profiler.stages())
+  {
+    ImGui::Text("%s", stage.name.c_str());
+    ImGui::NextColumn();
+    ImGui::Text("%.3f", stage.seconds * 1000.0);
+    ImGui::NextColumn();
+    ImGui::Text("%.3f", stage.averageSeconds * 1000.0);
+    ImGui::NextColumn();
+    ImGui::Text("%llu", static_cast<unsigned long long>(stage.calls));
+    ImGui::NextColumn();
+  }
+  ImGui::Columns(1);
+  for (auto &counter : profiler.counters())
+    ImGui::Text("%s: %.3g/s", counter.name.c_str(), counter.perSecond);
+#else
+  ImGui::TextDisabled("Stage timings compiled out (RTC_PROFILING=OFF)");
+#endif
+
+  ImGui::End();
+}
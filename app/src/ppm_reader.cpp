@@ -0,0 +1,108 @@
+#include <bit>
+
+#include "app/ppm_reader.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace PPM
+{
+  void P3Scanner::emit(uint16_t *out, std::size_t &got)
+  {
+    if (value_ > static_cast<uint32_t>(maxval_))
+      throw std::runtime_error("PPM sample above maxval");
+    out[got++] = static_cast<uint16_t>(value_);
+    inNumber_ = false;
+  }
+
+  const char *P3Scanner::scan(const char *p, const char *end, uint16_t *out, std::size_t want, std::size_t &got)
+  {
+#if defined(__SSE2__)
+    const auto zero = _mm_set1_epi8('0');
+    const auto nine = _mm_set1_epi8(9);
+    while (got < want && end - p >= 16)
+    {
+      auto c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+      auto d = _mm_sub_epi8(c, zero);
+      auto isDigit = _mm_cmpeq_epi8(_mm_min_epu8(d, nine), d);
+      auto isSpace = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')),
+                                               _mm_cmpeq_epi8(c, _mm_set1_epi8('\n'))),
+                                  _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('\r')),
+                                               _mm_cmpeq_epi8(c, _mm_set1_epi8('\t'))));
+      auto digits = static_cast<uint32_t>(_mm_movemask_epi8(isDigit));
+      auto spaces = static_cast<uint32_t>(_mm_movemask_epi8(isSpace));
+      // Anything else is an error, leave it to the scalar loop to report
+      if ((digits | spaces) != 0xffff)
+        break;
+
+      int i = 0;
+      while (i < 16)
+      {
+        auto rest = digits >> i;
+        if (!inNumber_)
+        {
+          if (rest == 0)
+            break;
+          i += std::countr_zero(rest);
+          rest = digits >> i;
+          inNumber_ = true;
+          value_ = 0;
+        }
+        // Bits past the block are zero in `rest`, so the run stops there
+        int run = std::countr_one(rest);
+        for (int k = 0; k < run; k++)
+        {
+          value_ = value_ * 10 + (p[i + k] - '0');
+          if (value_ > 65535)
+            throw std::runtime_error("PPM sample above maxval");
+        }
+        i += run;
+        if (i < 16)
+        {
+          emit(out, got);
+          if (got == want)
+            return p + i;
+        }
+      }
+      p += 16;
+    }
+#endif
+
+    for (; p < end && got < want; p++)
+    {
+      auto c = static_cast<unsigned char>(*p);
+      if (static_cast<unsigned>(c - '0') < 10u)
+      {
+        if (!inNumber_)
+        {
+          inNumber_ = true;
+          value_ = 0;
+        }
+        value_ = value_ * 10 + (c - '0');
+        if (value_ > 65535)
+          throw std::runtime_error("PPM sample above maxval");
+      }
+      else if (IsSpace(c))
+      {
+        if (inNumber_)
+        {
+          emit(out, got);
+          if (got == want)
+            return p;
+        }
+      }
+      else
+      {
+        throw std::runtime_error("Unexpected character in PPM payload");
+      }
+    }
+    return p;
+  }
+
+  void P3Scanner::finish(uint16_t *out, std::size_t want, std::size_t &got)
+  {
+    if (inNumber_ && got < want)
+      emit(out, got);
+  }
+} // End PPM
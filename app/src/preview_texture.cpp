@@ -0,0 +1,85 @@
+#include "app/preview_texture.h"
+
+#include <cassert>
+
+PreviewTexture::PreviewTexture(int w, int h) : w_{w}, h_{h}
+{
+  glGenTextures(1, &texture_);
+  glBindTexture(GL_TEXTURE_2D, texture_);
+  // No mipmaps, they would have to be rebuilt after every upload
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w_, h_, 0, GL_RGB, GL_FLOAT, nullptr);
+
+  // Sized for the worst case, a fully dirty canvas
+  auto bytes = 3 * static_cast<GLsizeiptr>(w_) * h_ * sizeof(float);
+  glGenBuffers(2, pbos_);
+  for (auto pbo : pbos_)
+  {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+PreviewTexture::~PreviewTexture()
+{
+  glDeleteBuffers(2, pbos_);
+  glDeleteTextures(1, &texture_);
+}
+
+void PreviewTexture::update(Canvas<float> &canvas)
+{
+  assert(canvas.width() == w_);
+  assert(canvas.height() == h_);
+  lastUploadBytes_ = 0;
+  auto rects = canvas.takeDirtyRects();
+  if (rects.empty())
+    return;
+
+  std::size_t bytes = 0;
+  for (const auto &r : rects)
+    bytes += 3 * static_cast<std::size_t>(r.w) * r.h * sizeof(float);
+
+  auto pbo = pbos_[next_];
+  next_ ^= 1;
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+  // Invalidating lets the driver hand out fresh storage instead of waiting
+  // for a transfer still reading the old contents
+  auto mapped = static_cast<char *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+                                                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+  if (!mapped)
+  {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    canvas.markDirty(0, 0, w_, h_);
+    return;
+  }
+  std::size_t offset = 0;
+  for (const auto &r : rects)
+  {
+    canvas.copyRect(r, reinterpret_cast<float *>(mapped + offset));
+    offset += 3 * static_cast<std::size_t>(r.w) * r.h * sizeof(float);
+  }
+  if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) != GL_TRUE)
+  {
+    // The buffer contents were lost (e.g. a mode switch), try again next frame
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    canvas.markDirty(0, 0, w_, h_);
+    return;
+  }
+
+  glBindTexture(GL_TEXTURE_2D, texture_);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  offset = 0;
+  for (const auto &r : rects)
+  {
+    // With a PBO bound the pointer is an offset into it
+    glTexSubImage2D(GL_TEXTURE_2D, 0, r.x, r.y, r.w, r.h, GL_RGB, GL_FLOAT,
+                    reinterpret_cast<const void *>(offset));
+    offset += 3 * static_cast<std::size_t>(r.w) * r.h * sizeof(float);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  lastUploadBytes_ = bytes;
+}
@@ -0,0 +1,84 @@
+#include "app/profiler.h"
+
+#include <algorithm>
+
+namespace Profiling
+{
+  namespace
+  {
+    // Weight of the newest frame in the smoothed values
+    constexpr double kSmoothing = 0.1;
+
+    template <typename Entry>
+    Entry &find(std::vector<Entry> &entries, std::string_view name)
+    {
+      auto it = std::find_if(entries.begin(), entries.end(), [&](const Entry &e)
+                             { return e.stats.name == name; });
+      if (it != entries.end())
+        return *it;
+      entries.push_back(Entry{});
+      entries.back().stats.name = std::string(name);
+      return entries.back();
+    }
+  }
+
+  Profiler &Profiler::Instance()
+  {
+    static Profiler profiler;
+    return profiler;
+  }
+
+  void Profiler::record(std::string_view stage, double seconds)
+  {
+    auto lock = std::lock_guard(mx_);
+    auto &s = find(stages_, stage);
+    s.pendingSeconds += seconds;
+    s.pendingCalls++;
+  }
+
+  void Profiler::count(std::string_view counter, uint64_t n)
+  {
+    auto lock = std::lock_guard(mx_);
+    find(counters_, counter).pending += n;
+  }
+
+  void Profiler::endFrame(double seconds)
+  {
+    auto lock = std::lock_guard(mx_);
+    for (auto &s : stages_)
+    {
+      s.stats.seconds = s.pendingSeconds;
+      s.stats.calls = s.pendingCalls;
+      s.stats.averageSeconds += kSmoothing * (s.pendingSeconds - s.stats.averageSeconds);
+      s.pendingSeconds = 0;
+      s.pendingCalls = 0;
+    }
+    for (auto &c : counters_)
+    {
+      c.stats.lastFrame = c.pending;
+      if (seconds > 0)
+        c.stats.perSecond += kSmoothing * (c.pending / seconds - c.stats.perSecond);
+      c.pending = 0;
+    }
+  }
+
+  std::vector<StageStats> Profiler::stages() const
+  {
+    auto lock = std::lock_guard(mx_);
+    auto res = std::vector<StageStats>();
+    res.reserve(stages_.size());
+    for (auto &s : stages_)
+      res.push_back(s.stats);
+    return res;
+  }
+
+  std::vector<CounterStats> Profiler::counters() const
+  {
+    auto lock = std::lock_guard(mx_);
+    auto res = std::vector<CounterStats>();
+    res.reserve(counters_.size());
+    for (auto &c : counters_)
+      res.push_back(c.stats);
+    return res;
+  }
+} // End Profiling
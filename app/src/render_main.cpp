@@ -0,0 +1,138 @@
+#include <charconv>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <fmt/core.h>
+#include "spdlog/spdlog.h"
+
+#include "app/batch_render.h"
+#include "app/canvas.h"
+#include "app/demo_scene.h"
+
+// Headless counterpart of rtc_project: renders the scene straight to a
+// file, for machines without a display.
+
+static void usage(const char *argv0)
+{
+  fmt::print(stderr,
+             "usage: {} [options]\n"
+             "  --width N          image width (500)\n"
+             "  --height N         image height (500)\n"
+             "  --threads N        render threads, 0 for one per core (0)\n"
+             "  --samples N        samples per pixel (1)\n"
+             "  --time-budget S    stop adding samples after S seconds, 0 for no limit (0)\n"
+             "  --output FILE      image to write (render.ppm)\n"
+             "  --format F         p3, p6 or qoi (from the file name: qoi for .qoi, p6 for\n"
+             "                     .p6.ppm, else p3)\n",
+             argv0);
+}
+
+template <typename T>
+static std::optional<T> parseNumber(std::string_view s)
+{
+  T v{};
+  auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+  if (ec != std::errc() || end != s.data() + s.size())
+    return std::nullopt;
+  return v;
+}
+
+static std::optional<ImageFormat> parseFormat(std::string_view s)
+{
+  if (s == "p3")
+    return ImageFormat::PPM_P3;
+  if (s == "p6")
+    return ImageFormat::PPM_P6;
+  if (s == "qoi")
+    return ImageFormat::QOI;
+  return std::nullopt;
+}
+
+int main(int argc, char **argv)
+{
+  auto opts = BatchOptions{};
+  auto output = std::string("render.ppm");
+  auto format = std::optional<ImageFormat>();
+
+  for (int i = 1; i < argc; i++)
+  {
+    auto arg = std::string_view(argv[i]);
+    if (arg == "-h" || arg == "--help")
+    {
+      usage(argv[0]);
+      return 0;
+    }
+    if (i + 1 >= argc)
+    {
+      fmt::print(stderr, "{}: missing value for {}\n", argv[0], arg);
+      usage(argv[0]);
+      return 2;
+    }
+    auto value = std::string_view(argv[++i]);
+    bool ok = true;
+    if (arg == "--width" || arg == "--height" || arg == "--samples")
+    {
+      auto &field = arg == "--width" ? opts.width : arg == "--height" ? opts.height : opts.samples;
+      auto n = parseNumber<int>(value);
+      ok = n && *n > 0;
+      if (ok)
+        field = *n;
+    }
+    else if (arg == "--threads")
+    {
+      auto n = parseNumber<unsigned>(value);
+      ok = n.has_value();
+      if (ok)
+        opts.threads = *n;
+    }
+    else if (arg == "--time-budget")
+    {
+      auto s = parseNumber<double>(value);
+      ok = s && *s >= 0;
+      if (ok)
+        opts.timeBudget = *s;
+    }
+    else if (arg == "--output")
+    {
+      output = value;
+    }
+    else if (arg == "--format")
+    {
+      format = parseFormat(value);
+      ok = format.has_value();
+    }
+    else
+    {
+      fmt::print(stderr, "{}: unknown option {}\n", argv[0], arg);
+      usage(argv[0]);
+      return 2;
+    }
+    if (!ok)
+    {
+      fmt::print(stderr, "{}: bad value for {}: {}\n", argv[0], arg, value);
+      return 2;
+    }
+  }
+
+  auto scene = SphereScene{};
+  auto start = std::chrono::steady_clock::now();
+  auto res = RenderBatch(opts, [&](float u, float v)
+                         { return scene.shade(u, v, opts.width, opts.height); });
+  auto rendered = std::chrono::steady_clock::now();
+  try
+  {
+    res.canvas.writeFile(output, format.value_or(ImageFormatFor(output)), opts.threads);
+  }
+  catch (const std::exception &e)
+  {
+    spdlog::error("Writing {} failed: {}", output, e.what());
+    return 1;
+  }
+  auto written = std::chrono::steady_clock::now();
+  spdlog::info("{}x{} at {} spp: rendered in {} ms, written to {} in {} ms", opts.width, opts.height, res.samples,
+               std::chrono::duration_cast<std::chrono::milliseconds>(rendered - start).count(), output,
+               std::chrono::duration_cast<std::chrono::milliseconds>(written - rendered).count());
+  return 0;
+}
@@ -0,0 +1,203 @@
+#include <algorithm>
+
+#include "app/transform_batch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RTC_X86_SIMD 1
+#endif
+
+namespace Matrix
+{
+#ifdef RTC_X86_SIMD
+  namespace
+  {
+    template <bool Point>
+    void TransformSse2(const Matrix4<float> &m, ConstTupleSpan<float> in, TupleSpan<float> out)
+    {
+      __m128 r[3][4];
+      for (uint_fast32_t row = 0; row < 3; row++)
+      {
+        for (uint_fast32_t col = 0; col < 4; col++)
+        {
+          r[row][col] = _mm_set1_ps(m(row, col));
+        }
+      }
+      std::size_t i = 0;
+      for (; i + 4 <= in.size; i += 4)
+      {
+        auto x = _mm_loadu_ps(in.x + i);
+        auto y = _mm_loadu_ps(in.y + i);
+        auto z = _mm_loadu_ps(in.z + i);
+        __m128 res[3];
+        for (uint_fast32_t row = 0; row < 3; row++)
+        {
+          res[row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[row][0], x), _mm_mul_ps(r[row][1], y)),
+                                _mm_mul_ps(r[row][2], z));
+          if constexpr (Point)
+            res[row] = _mm_add_ps(res[row], r[row][3]);
+        }
+        _mm_storeu_ps(out.x + i, res[0]);
+        _mm_storeu_ps(out.y + i, res[1]);
+        _mm_storeu_ps(out.z + i, res[2]);
+      }
+      TransformBatchScalar<float, Point>(m, in, out, i);
+    }
+
+    template <bool Point>
+    void TransformSse2(const Matrix4<double> &m, ConstTupleSpan<double> in, TupleSpan<double> out)
+    {
+      __m128d r[3][4];
+      for (uint_fast32_t row = 0; row < 3; row++)
+      {
+        for (uint_fast32_t col = 0; col < 4; col++)
+        {
+          r[row][col] = _mm_set1_pd(m(row, col));
+        }
+      }
+      std::size_t i = 0;
+      for (; i + 2 <= in.size; i += 2)
+      {
+        auto x = _mm_loadu_pd(in.x + i);
+        auto y = _mm_loadu_pd(in.y + i);
+        auto z = _mm_loadu_pd(in.z + i);
+        __m128d res[3];
+        for (uint_fast32_t row = 0; row < 3; row++)
+        {
+          res[row] = _mm_add_pd(_mm_add_pd(_mm_mul_pd(r[row][0], x), _mm_mul_pd(r[row][1], y)),
+                                _mm_mul_pd(r[row][2], z));
+          if constexpr (Point)
+            res[row] = _mm_add_pd(res[row], r[row][3]);
+        }
+        _mm_storeu_pd(out.x + i, res[0]);
+        _mm_storeu_pd(out.y + i, res[1]);
+        _mm_storeu_pd(out.z + i, res[2]);
+      }
+      TransformBatchScalar<double, Point>(m, in, out, i);
+    }
+
+    template <bool Point>
+    __attribute__((target("avx2,fma"))) void TransformAvx2(const Matrix4<float> &m, ConstTupleSpan<float> in,
+                                                           TupleSpan<float> out)
+    {
+      __m256 r[3][4];
+      for (uint_fast32_t row = 0; row < 3; row++)
+      {
+        for (uint_fast32_t col = 0; col < 4; col++)
+        {
+          r[row][col] = _mm256_set1_ps(m(row, col));
+        }
+      }
+      std::size_t i = 0;
+      for (; i + 8 <= in.size; i += 8)
+      {
+        auto x = _mm256_loadu_ps(in.x + i);
+        auto y = _mm256_loadu_ps(in.y + i);
+        auto z = _mm256_loadu_ps(in.z + i);
+        __m256 res[3];
+        for (uint_fast32_t row = 0; row < 3; row++)
+        {
+          res[row] = Point ? r[row][3] : _mm256_setzero_ps();
+          res[row] = _mm256_fmadd_ps(r[row][0], x, res[row]);
+          res[row] = _mm256_fmadd_ps(r[row][1], y, res[row]);
+          res[row] = _mm256_fmadd_ps(r[row][2], z, res[row]);
+        }
+        _mm256_storeu_ps(out.x + i, res[0]);
+        _mm256_storeu_ps(out.y + i, res[1]);
+        _mm256_storeu_ps(out.z + i, res[2]);
+      }
+      TransformBatchScalar<float, Point>(m, in, out, i);
+    }
+
+    template <bool Point>
+    __attribute__((target("avx2,fma"))) void TransformAvx2(const Matrix4<double> &m, ConstTupleSpan<double> in,
+                                                           TupleSpan<double> out)
+    {
+      __m256d r[3][4];
+      for (uint_fast32_t row = 0; row < 3; row++)
+      {
+        for (uint_fast32_t col = 0; col < 4; col++)
+        {
+          r[row][col] = _mm256_set1_pd(m(row, col));
+        }
+      }
+      std::size_t i = 0;
+      for (; i + 4 <= in.size; i += 4)
+      {
+        auto x = _mm256_loadu_pd(in.x + i);
+        auto y = _mm256_loadu_pd(in.y + i);
+        auto z = _mm256_loadu_pd(in.z + i);
+        __m256d res[3];
+        for (uint_fast32_t row = 0; row < 3; row++)
+        {
+          res[row] = Point ? r[row][3] : _mm256_setzero_pd();
+          res[row] = _mm256_fmadd_pd(r[row][0], x, res[row]);
+          res[row] = _mm256_fmadd_pd(r[row][1], y, res[row]);
+          res[row] = _mm256_fmadd_pd(r[row][2], z, res[row]);
+        }
+        _mm256_storeu_pd(out.x + i, res[0]);
+        _mm256_storeu_pd(out.y + i, res[1]);
+        _mm256_storeu_pd(out.z + i, res[2]);
+      }
+      TransformBatchScalar<double, Point>(m, in, out, i);
+    }
+  }
+#endif
+
+  SimdLevel DetectSimd()
+  {
+#ifdef RTC_X86_SIMD
+    static const SimdLevel level = []
+    {
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return SimdLevel::AVX2;
+      if (__builtin_cpu_supports("sse2"))
+        return SimdLevel::SSE2;
+      return SimdLevel::Scalar;
+    }();
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+  }
+
+  namespace
+  {
+    template <bool Point, class T>
+    void Dispatch(const Matrix4<T> &m, ConstTupleSpan<T> in, TupleSpan<T> out, SimdLevel level)
+    {
+      assert(in.size == out.size);
+      if constexpr (Point)
+        assert(IsAffine(m));
+      level = std::min(level, DetectSimd());
+#ifdef RTC_X86_SIMD
+      if (level == SimdLevel::AVX2)
+        return TransformAvx2<Point>(m, in, out);
+      if (level == SimdLevel::SSE2)
+        return TransformSse2<Point>(m, in, out);
+#endif
+      TransformBatchScalar<T, Point>(m, in, out);
+    }
+  }
+
+  void TransformPoints(const Matrix4<float> &m, ConstTupleSpan<float> in, TupleSpan<float> out, SimdLevel level)
+  {
+    Dispatch<true>(m, in, out, level);
+  }
+
+  void TransformPoints(const Matrix4<double> &m, ConstTupleSpan<double> in, TupleSpan<double> out, SimdLevel level)
+  {
+    Dispatch<true>(m, in, out, level);
+  }
+
+  void TransformVectors(const Matrix4<float> &m, ConstTupleSpan<float> in, TupleSpan<float> out, SimdLevel level)
+  {
+    Dispatch<false>(m, in, out, level);
+  }
+
+  void TransformVectors(const Matrix4<double> &m, ConstTupleSpan<double> in, TupleSpan<double> out, SimdLevel level)
+  {
+    Dispatch<false>(m, in, out, level);
+  }
+} // End Matrix
@@ -0,0 +1,103 @@
+#include <app/accumulation.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+
+class AccumulationTest : public ::testing::Test
+{
+
+protected:
+  virtual void SetUp(){};
+
+  virtual void TearDown(){};
+};
+
+TEST_F(AccumulationTest, resolves_to_the_mean)
+{
+  auto acc = AccumulationBuffer<float>(3, 2);
+  acc.addSample(Color::Color<float>(1, 0, 0), 1, 1);
+  acc.addSample(Color::Color<float>(0, 1, 0.5f), 1, 1);
+  ASSERT_EQ(acc.samples(1, 1), 2u);
+  ASSERT_EQ(acc.samples(0, 0), 0u);
+
+  auto canvas = Canvas<float>(3, 2);
+  canvas.writePixel(Color::Color<float>(1, 1, 1), 0, 0);
+  acc.resolve(canvas);
+  ASSERT_EQ(canvas.pixelAt(1, 1), Color::Color<float>(0.5f, 0.5f, 0.25f));
+  // Pixels without samples resolve to black
+  ASSERT_EQ(canvas.pixelAt(0, 0), Color::Color<float>(0, 0, 0));
+
+  acc.clear();
+  ASSERT_EQ(acc.samples(1, 1), 0u);
+}
+
+TEST_F(AccumulationTest, small_samples_are_not_lost)
+{
+  auto acc = AccumulationBuffer<float>(1, 1);
+  acc.addSample(Color::Color<float>(1e8f, 0, 0), 0, 0);
+  for (auto i = 0; i < 1000; i++)
+    acc.addSample(Color::Color<float>(1, 1, 0), 0, 0);
+  // A float running sum would stay at 1e8 and lose the ones entirely
+  ASSERT_NEAR(acc.pixelAt(0, 0).r(), (1e8 + 1000) / 1001, 1e-2);
+}
+
+TEST_F(AccumulationTest, concurrent_samples_and_resolve)
+{
+  constexpr int threads = 8;
+  constexpr int passes = 50;
+  auto acc = AccumulationBuffer<double>(16, 16);
+  auto done = std::atomic<bool>(false);
+  auto preview = Canvas<double, CanvasLayout::Tiled<4, 4>>(16, 16);
+  // Resolve keeps running while the render adds samples
+  auto resolver = std::thread([&]
+                              {
+    while (!done.load())
+      acc.resolve(preview); });
+  auto workers = std::vector<std::thread>();
+  for (auto t = 0; t < threads; t++)
+  {
+    workers.emplace_back([&acc]
+                         {
+      for (auto pass = 0; pass < passes; pass++)
+      {
+        for (auto y = 0; y < 16; y++)
+        {
+          for (auto x = 0; x < 16; x++)
+          {
+            acc.addSample(Color::Color<double>(pass % 2, 0.25, 1), x, y);
+          }
+        }
+      } });
+  }
+  for (auto &w : workers)
+    w.join();
+  done = true;
+  resolver.join();
+
+  acc.resolve(preview);
+  for (auto y = 0; y < 16; y++)
+  {
+    for (auto x = 0; x < 16; x++)
+    {
+      ASSERT_EQ(acc.samples(x, y), static_cast<uint32_t>(threads * passes));
+      ASSERT_EQ(preview.pixelAt(x, y), Color::Color<double>(0.5, 0.25, 1));
+    }
+  }
+}
+
+TEST_F(AccumulationTest, first_sample_is_the_pixel_center)
+{
+  auto [u, v] = Sampling::SampleOffset(0);
+  ASSERT_FLOAT_EQ(u, 0.5f);
+  ASSERT_FLOAT_EQ(v, 0.5f);
+  for (int i = 1; i < 64; i++)
+  {
+    auto [du, dv] = Sampling::SampleOffset(i);
+    ASSERT_GE(du, 0.f);
+    ASSERT_LT(du, 1.f);
+    ASSERT_GE(dv, 0.f);
+    ASSERT_LT(dv, 1.f);
+  }
+}
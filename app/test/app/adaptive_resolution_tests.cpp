@@ -0,0 +1,61 @@
+#include <app/adaptive_resolution.h>
+
+#include "gtest/gtest.h"
+
+class AdaptiveResolutionTest : public ::testing::Test
+{
+
+protected:
+  virtual void SetUp(){};
+
+  virtual void TearDown(){};
+};
+
+TEST_F(AdaptiveResolutionTest, coarsest_until_measured)
+{
+  auto res = AdaptiveResolution(400, 400);
+  ASSERT_EQ(res.restart(), 8);
+  ASSERT_EQ(res.predictedSeconds(1), 0.0);
+}
+
+TEST_F(AdaptiveResolutionTest, refines_to_full_resolution)
+{
+  auto res = AdaptiveResolution(400, 400);
+  ASSERT_EQ(res.restart(), 8);
+  ASSERT_EQ(res.refine(), 4);
+  ASSERT_EQ(res.refine(), 2);
+  ASSERT_EQ(res.refine(), 1);
+  ASSERT_EQ(res.refine(), 0);
+  ASSERT_EQ(res.scale(), 1);
+}
+
+TEST_F(AdaptiveResolutionTest, picks_finest_level_within_the_frame)
+{
+  // 160000 pixels, 1 us per sample on 2 threads: 80 ms at full resolution,
+  // 20 ms at half
+  auto res = AdaptiveResolution(400, 400, 30.0, 2);
+  res.measured(1000, 1000 * 1e-6);
+  ASSERT_DOUBLE_EQ(res.predictedSeconds(1), 0.08);
+  ASSERT_EQ(res.restart(), 2);
+
+  // Cheap enough for full resolution
+  res.setTargetFps(10.0);
+  ASSERT_EQ(res.restart(), 1);
+  ASSERT_EQ(res.refine(), 0);
+
+  // Far too expensive for anything but the coarsest level
+  res.setTargetFps(1000.0);
+  ASSERT_EQ(res.restart(), 8);
+}
+
+TEST_F(AdaptiveResolutionTest, smooths_measurements)
+{
+  auto res = AdaptiveResolution(100, 100);
+  res.measured(100, 100e-6);
+  res.measured(100, 600e-6);
+  // 0.8 * 1 us + 0.2 * 6 us
+  ASSERT_NEAR(res.predictedSeconds(1), 10000 * 2e-6, 1e-12);
+  // Empty frames don't count
+  res.measured(0, 0.1);
+  ASSERT_NEAR(res.predictedSeconds(1), 10000 * 2e-6, 1e-12);
+}
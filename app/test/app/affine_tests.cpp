@@ -0,0 +1,83 @@
+#include "app/affine.h"
+#include "app/matrix.h"
+#include "app/tuple.h"
+
+#include "gtest/gtest.h"
+
+using Matrix::AffineTransform;
+using Tuple::Point;
+using Tuple::Vector;
+
+class AffineTest : public ::testing::Test
+{
+protected:
+  virtual void SetUp(){};
+  virtual void TearDown(){};
+};
+
+TEST_F(AffineTest, affine_round_trips_matrix4)
+{
+  auto m = Matrix::Translation(5., -3., 2.).rotate_y(PI / 3.).shear(1., 0., 0., 1., 0., 0.);
+  auto a = AffineTransform<double>(m);
+  ASSERT_EQ(a.matrix(), m);
+  ASSERT_EQ(AffineTransform<double>().matrix(), Matrix::Identity<double>());
+}
+
+TEST_F(AffineTest, affine_compose_matches_matrix4)
+{
+  auto m1 = Matrix::RotationX(PI / 2.).scale(5., 5., 5.);
+  auto m2 = Matrix::Translation(10., 5., 7.).shear(0., 1., 0., 0., 1., 0.);
+  auto a1 = AffineTransform<double>(m1);
+  auto a2 = AffineTransform<double>(m2);
+  ASSERT_EQ((a2 * a1).matrix(), m2 * m1);
+
+  auto fluent = AffineTransform<double>()
+                    .rotate_x(PI / 2.)
+                    .scale(5, 5, 5)
+                    .translate(10, 5, 7);
+  ASSERT_EQ(fluent * Point(1., 0., 1.), Point(15., 0., 7.));
+  ASSERT_EQ(fluent * Vector(1., 0., 1.), Vector(5., -5., 0.));
+}
+
+TEST_F(AffineTest, affine_inverse_matches_matrix4)
+{
+  auto m = Matrix::Translation(1., 2., 3.).rotate_z(PI / 5.).scale(2., 3., 4.);
+  auto a = AffineTransform<double>(m);
+  ASSERT_TRUE(a.invertible());
+  ASSERT_EQ(a.inverse().matrix(), m.inverse());
+  ASSERT_EQ(a.inverse() * a, AffineTransform<double>());
+  ASSERT_THROW(AffineTransform<double>(Matrix::Scaling(0., 1., 1.)).inverse(), std::runtime_error);
+}
+
+TEST_F(AffineTest, affine_normal_matrix)
+{
+  auto a = AffineTransform<double>().rotate_z(PI / 5.).scale(1., 0.5, 1.).translate(0., 1., 0.);
+  auto normal_matrix = a.inverse_transpose();
+  ASSERT_EQ(normal_matrix, a.inverse().linear().t());
+
+  auto n = Matrix::TransformNormal(normal_matrix, Vector(0., sqrt(2.) / 2., -sqrt(2.) / 2.));
+  auto expected = a.matrix().inverse().t() * Vector(0., sqrt(2.) / 2., -sqrt(2.) / 2.);
+  ASSERT_EQ(n, Vector(expected.x(), expected.y(), expected.z()));
+}
+
+TEST_F(AffineTest, affine_normal_matrix_is_cached)
+{
+  auto a = AffineTransform<double>().rotate_z(PI / 5.).scale(1., 0.5, 1.);
+  ASSERT_FALSE(a.normal_cached());
+  const auto &first = a.inverse_transpose();
+  ASSERT_TRUE(a.normal_cached());
+  ASSERT_EQ(&a.inverse_transpose(), &first);
+
+  // Translation leaves normals alone, anything else starts over
+  auto moved = a.translate(1., 2., 3.);
+  ASSERT_TRUE(moved.normal_cached());
+  ASSERT_EQ(moved.inverse_transpose(), a.inverse_transpose());
+  auto scaled = a.scale(2., 2., 2.);
+  ASSERT_FALSE(scaled.normal_cached());
+  ASSERT_EQ(scaled.inverse_transpose(), scaled.linear().inverse().t());
+
+  // An inverse gets its normal matrix for free
+  auto inv = a.inverse();
+  ASSERT_TRUE(inv.normal_cached());
+  ASSERT_EQ(inv.inverse_transpose(), inv.linear().inverse().t());
+}
@@ -0,0 +1,87 @@
+#include <app/batch_render.h>
+#include <app/demo_scene.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include "gtest/gtest.h"
+
+class BatchRenderTest : public ::testing::Test
+{
+
+protected:
+  virtual void SetUp(){};
+
+  virtual void TearDown(){};
+};
+
+TEST_F(BatchRenderTest, averages_samples_on_every_thread)
+{
+  auto opts = BatchOptions{37, 21, 4, 16};
+  auto calls = std::atomic<int>(0);
+  auto res = RenderBatch(opts, [&](float u, float v)
+                         {
+                           calls++;
+                           // The pixel's own coordinates, whatever the offset
+                           return Color::Color<float>(std::floor(u), std::floor(v), u - std::floor(u)); });
+  ASSERT_EQ(calls.load(), 37 * 21 * 16);
+  ASSERT_EQ(res.samples, 16);
+  float mean = 0.f;
+  for (int i = 0; i < 16; i++)
+    mean += Sampling::SampleOffset(i).first;
+  mean /= 16;
+  for (int y = 0; y < 21; y++)
+  {
+    for (int x = 0; x < 37; x++)
+    {
+      auto c = res.canvas.pixelAt(x, y);
+      ASSERT_FLOAT_EQ(c.r(), x);
+      ASSERT_FLOAT_EQ(c.g(), y);
+      ASSERT_NEAR(c.b(), mean, 1e-5f);
+    }
+  }
+}
+
+TEST_F(BatchRenderTest, renders_the_demo_sphere)
+{
+  auto scene = SphereScene{};
+  auto canvas = RenderBatch(BatchOptions{64, 64, 2, 4}, [&](float u, float v)
+                            { return scene.shade(u, v, 64, 64); })
+                    .canvas;
+  ASSERT_EQ(canvas.pixelAt(0, 0), Color::Color<float>(0, 0, 0));
+  ASSERT_GT(canvas.pixelAt(32, 32).r(), 0.5f);
+  // Lit from the upper left
+  ASSERT_GT(canvas.pixelAt(26, 26).r(), canvas.pixelAt(38, 38).r());
+}
+
+TEST_F(BatchRenderTest, time_budget_stops_after_a_whole_pass)
+{
+  auto opts = BatchOptions{16, 8, 2, 1000};
+  opts.timeBudget = 0.02;
+  auto calls = std::atomic<int>(0);
+  auto res = RenderBatch(opts, [&](float u, float)
+                         {
+                           calls++;
+                           std::this_thread::sleep_for(std::chrono::microseconds(100));
+                           return Color::Color<float>(u - std::floor(u), 0, 0); });
+  ASSERT_GE(res.samples, 1);
+  ASSERT_LT(res.samples, 1000);
+  // Every pixel got the same number of samples
+  ASSERT_EQ(calls.load(), 16 * 8 * res.samples);
+  float mean = 0.f;
+  for (int i = 0; i < res.samples; i++)
+    mean += Sampling::SampleOffset(i).first;
+  mean /= res.samples;
+  ASSERT_NEAR(res.canvas.pixelAt(5, 3).r(), mean, 1e-5f);
+}
+
+TEST_F(BatchRenderTest, first_pass_completes_whatever_the_budget)
+{
+  auto opts = BatchOptions{8, 8, 1, 4};
+  opts.timeBudget = 1e-9;
+  auto res = RenderBatch(opts, [](float u, float v)
+                         { return Color::Color<float>(std::floor(u), std::floor(v), 1); });
+  ASSERT_EQ(res.samples, 1);
+  ASSERT_EQ(res.canvas.pixelAt(7, 2), Color::Color<float>(7, 2, 1));
+}
@@ -0,0 +1,95 @@
+#include <app/canvas_pool.h>
+
+#include "gtest/gtest.h"
+
+class CanvasPoolTest : public ::testing::Test
+{
+
+protected:
+  virtual void SetUp(){};
+
+  virtual void TearDown(){};
+};
+
+TEST_F(CanvasPoolTest, reuses_buffers_of_the_same_size)
+{
+  auto pool = CanvasPool<float>();
+  auto first = pool.acquire(64, 32);
+  auto data = first.data();
+  first.writePixel(Color::Color<float>(1, 1, 1), 5, 5);
+  pool.release(std::move(first));
+  ASSERT_EQ(first.width(), 0);
+  ASSERT_EQ(pool.idle(), 1u);
+
+  // Same buffer, cleared
+  auto second = pool.acquire(64, 32);
+  ASSERT_EQ(second.data(), data);
+  ASSERT_EQ(second.pixelAt(5, 5), Color::Color<float>(0, 0, 0));
+  ASSERT_EQ(pool.hits(), 1u);
+  ASSERT_EQ(pool.misses(), 1u);
+
+  // Other sizes allocate
+  auto other = pool.acquire(32, 32);
+  ASSERT_NE(other.data(), data);
+  ASSERT_EQ(pool.misses(), 2u);
+}
+
+TEST_F(CanvasPoolTest, steady_state_frames_do_not_allocate)
+{
+  auto pool = CanvasPool<float>(2);
+  for (auto frame = 0; frame < 10; frame++)
+  {
+    auto canvas = pool.acquire(16, 16);
+    canvas.writePixel(Color::Color<float>(frame / 10.f, 0, 0), frame, frame);
+    pool.release(std::move(canvas));
+  }
+  ASSERT_EQ(pool.misses(), 1u);
+  ASSERT_EQ(pool.hits(), 9u);
+}
+
+TEST_F(CanvasPoolTest, steady_state_acquire_release_has_no_heap_allocations)
+{
+  auto pool = CanvasPool<float, CanvasLayout::Tiled<4, 4>>(2);
+  // Warm up: the first frame allocates the buffer, the flags and the
+  // pool's own bookkeeping
+  pool.release(pool.acquire(200, 100));
+  auto heapBytes = CanvasMemory::HeapBytes();
+  auto buffers = CanvasMemory::HeapAllocations();
+  auto flags = DirtyTiles::Allocations();
+  for (auto frame = 0; frame < 20; frame++)
+  {
+    auto canvas = pool.acquire(200, 100);
+    canvas.writePixel(Color::Color<float>(1, 0, 0), frame, frame);
+    // Recycled flags start out all dirty like fresh ones
+    canvas.markDirty(0, 0, 1, 1);
+    pool.release(std::move(canvas));
+  }
+  ASSERT_EQ(CanvasMemory::HeapAllocations(), buffers);
+  ASSERT_EQ(DirtyTiles::Allocations(), flags);
+  ASSERT_EQ(CanvasMemory::HeapBytes(), heapBytes);
+  ASSERT_EQ(pool.misses(), 1u);
+
+  // Dirty state doesn't leak from one frame to the next
+  auto canvas = pool.acquire(200, 100);
+  canvas.takeDirtyRects();
+  canvas.writePixel(Color::Color<float>(1, 0, 0), 150, 70);
+  ASSERT_EQ(canvas.takeDirtyRects(), (std::vector<DirtyRect>{{128, 64, 64, 36}}));
+  pool.release(std::move(canvas));
+
+  // Same component count, other shape: the flags are rebuilt to match
+  auto transposed = CanvasPool<float>(1);
+  transposed.release(transposed.acquire(64, 32));
+  auto tall = transposed.acquire(32, 64);
+  ASSERT_EQ(transposed.hits(), 1u);
+  ASSERT_EQ(tall.takeDirtyRects(), (std::vector<DirtyRect>{{0, 0, 32, 64}}));
+}
+
+TEST_F(CanvasPoolTest, capacity_bounds_idle_buffers)
+{
+  auto pool = CanvasPool<double>(1);
+  auto a = pool.acquire(8, 8);
+  auto b = pool.acquire(8, 8);
+  pool.release(std::move(a));
+  pool.release(std::move(b));
+  ASSERT_EQ(pool.idle(), 1u);
+}
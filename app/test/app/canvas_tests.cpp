@@ -1,8 +1,15 @@
 #include <app/canvas.h>
 #include <app/color.h>
 
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <thread>
 #include <vector>
+#include <unistd.h>
 #include "gtest/gtest.h"
+#include "test_files.h"
 
 class CanvasTest : public ::testing::Test
 {
@@ -77,4 +84,423 @@ TEST_F(CanvasTest, canvas_construct_ppm_payload)
   canvas.writePixel(Color::Color(-0.5f, 0.f, 1.f), 4, 2);
   auto dut = canvas.mkPPMPayload();
   ASSERT_EQ(dut, ans);
-}
\ No newline at end of file
+}
+
+TEST_F(CanvasTest, canvas_quantize_matches_reference)
+{
+  for (auto i = -300; i < 600; i++)
+  {
+    auto c = i / 511.f;
+    ASSERT_EQ(PPM::Quantize(c), std::clamp((int)std::ceil(c * 255), 0, 255));
+    ASSERT_EQ(PPM::Quantize((double)c), std::clamp((int)std::ceil((double)c * 255), 0, 255));
+  }
+  ASSERT_EQ(PPM::Quantize(std::nanf("")), 0);
+  ASSERT_EQ(PPM::Quantize(1e30f), 255);
+}
+
+TEST_F(CanvasTest, canvas_write_file_matches_payload)
+{
+  // Wide enough to cross the writer's buffer several times
+  constexpr int w = 3000;
+  constexpr int h = 13;
+  auto canvas = Canvas<float>(w, h);
+  for (auto j = 0; j < h; j++)
+  {
+    for (auto i = 0; i < w; i++)
+    {
+      canvas.writePixel(Color::Color(i / (float)w, j / (float)h, (i * j % 256) / 255.f), i, j);
+    }
+  }
+  auto filename = TempPath("rtc_canvas_p3.ppm");
+  canvas.writeFile(filename);
+  ASSERT_EQ(ReadAll(filename), canvas.mkPPMHeader() + canvas.mkPPMPayload());
+  std::filesystem::remove(filename);
+}
+
+namespace
+{
+  void FillGradient(Canvas<float> &canvas)
+  {
+    auto w = canvas.width();
+    auto h = canvas.height();
+    for (auto j = 0; j < h; j++)
+    {
+      for (auto i = 0; i < w; i++)
+      {
+        // Flat areas, small steps and jumps hit every QOI op
+        auto flat = i < w / 4 ? 0.5f : i / (float)w;
+        canvas.writePixel(Color::Color(flat, j / (float)h, (i % 64) / 255.f), i, j);
+      }
+    }
+  }
+
+  std::vector<uint8_t> Quantized(Canvas<float> &canvas)
+  {
+    auto res = std::vector<uint8_t>();
+    for (auto j = 0; j < canvas.height(); j++)
+    {
+      for (auto i = 0; i < canvas.width(); i++)
+      {
+        auto c = canvas.pixelAt(i, j);
+        res.push_back(PPM::Quantize(c.r()));
+        res.push_back(PPM::Quantize(c.g()));
+        res.push_back(PPM::Quantize(c.b()));
+      }
+    }
+    return res;
+  }
+}
+
+TEST_F(CanvasTest, canvas_write_file_p6)
+{
+  auto canvas = Canvas<float>(200, 70);
+  FillGradient(canvas);
+  auto filename = TempPath("rtc_canvas_p6.ppm");
+  canvas.writeFile(filename, ImageFormat::PPM_P6);
+  auto data = ReadAll(filename);
+  auto header = std::string("P6\n200 70\n255\n");
+  ASSERT_EQ(data.substr(0, header.size()), header);
+  auto expected = Quantized(canvas);
+  ASSERT_EQ(data.substr(header.size()), std::string(expected.begin(), expected.end()));
+  std::filesystem::remove(filename);
+}
+
+TEST_F(CanvasTest, canvas_write_file_qoi_round_trips)
+{
+  auto canvas = Canvas<float>(300, 50);
+  FillGradient(canvas);
+  auto filename = TempPath("rtc_canvas.qoi");
+  ASSERT_EQ(ImageFormatFor(filename), ImageFormat::QOI);
+  canvas.writeFile(filename);
+  auto data = ReadAll(filename);
+  int w, h;
+  auto decoded = QOI::Decode(reinterpret_cast<const uint8_t *>(data.data()), data.size(), w, h);
+  ASSERT_EQ(w, 300);
+  ASSERT_EQ(h, 50);
+  ASSERT_EQ(decoded, Quantized(canvas));
+  // Lossless but still smaller than raw bytes
+  ASSERT_LT(data.size(), decoded.size());
+  std::filesystem::remove(filename);
+}
+
+TEST_F(CanvasTest, canvas_image_format_from_file_name)
+{
+  ASSERT_EQ(ImageFormatFor("out.qoi"), ImageFormat::QOI);
+  ASSERT_EQ(ImageFormatFor("OUT.QOI"), ImageFormat::QOI);
+  ASSERT_EQ(ImageFormatFor("out.p6.ppm"), ImageFormat::PPM_P6);
+  ASSERT_EQ(ImageFormatFor("out.P6.PPM"), ImageFormat::PPM_P6);
+  ASSERT_EQ(ImageFormatFor("out.ppm"), ImageFormat::PPM_P3);
+  ASSERT_EQ(ImageFormatFor("qoi"), ImageFormat::PPM_P3);
+}
+
+TEST_F(CanvasTest, canvas_qoi_decode_rejects_bad_input)
+{
+  auto canvas = Canvas<float>(40, 30);
+  FillGradient(canvas);
+  auto filename = TempPath("rtc_canvas_bad.qoi");
+  canvas.writeFile(filename);
+  auto data = ReadAll(filename);
+  std::filesystem::remove(filename);
+  auto decode = [](const std::string &bytes)
+  {
+    int w, h;
+    return QOI::Decode(reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size(), w, h);
+  };
+  ASSERT_NO_THROW(decode(data));
+
+  // Cut anywhere in the middle of the ops, end marker kept
+  auto marker = data.substr(data.size() - 8);
+  for (std::size_t keep = 14; keep < data.size() - 8; keep += 37)
+    ASSERT_THROW(decode(data.substr(0, keep) + marker), std::runtime_error) << keep;
+
+  auto withSize = [&](uint32_t w, uint32_t h)
+  {
+    auto res = data;
+    for (int i = 0; i < 4; i++)
+    {
+      res[4 + i] = static_cast<char>(w >> (24 - 8 * i));
+      res[8 + i] = static_cast<char>(h >> (24 - 8 * i));
+    }
+    return res;
+  };
+  ASSERT_THROW(decode(withSize(0, 30)), std::runtime_error);
+  ASSERT_THROW(decode(withSize(40, 0)), std::runtime_error);
+  ASSERT_THROW(decode(withSize(0xffffffff, 0xffffffff)), std::runtime_error);
+  // Plausible size, but far more pixels than the ops could cover
+  ASSERT_THROW(decode(withSize(20000, 20000)), std::runtime_error);
+}
+
+TEST_F(CanvasTest, canvas_parallel_encode_matches_serial)
+{
+  // Odd height so the last band is short
+  auto canvas = Canvas<float>(301, 257);
+  FillGradient(canvas);
+  auto serial = canvas.mkPPMPayload(1);
+  ASSERT_EQ(canvas.mkPPMPayload(4), serial);
+  ASSERT_EQ(canvas.mkPPMPayload(7), serial);
+
+  auto p3 = TempPath("rtc_canvas_parallel_p3.ppm");
+  auto p6 = TempPath("rtc_canvas_parallel_p6.ppm");
+  auto p6Serial = TempPath("rtc_canvas_serial_p6.ppm");
+  canvas.writeFile(p3, ImageFormat::PPM_P3, 5);
+  canvas.writeFile(p6, ImageFormat::PPM_P6, 5);
+  canvas.writeFile(p6Serial, ImageFormat::PPM_P6, 1);
+  ASSERT_EQ(ReadAll(p3), canvas.mkPPMHeader() + serial);
+  ASSERT_EQ(ReadAll(p6), ReadAll(p6Serial));
+  std::filesystem::remove(p3);
+  std::filesystem::remove(p6);
+  std::filesystem::remove(p6Serial);
+}
+
+TEST_F(CanvasTest, canvas_short_image_with_many_threads)
+{
+  // Fewer bands than threads, the extra threads are never started
+  auto canvas = Canvas<float>(40, 3);
+  FillGradient(canvas);
+  auto serial = canvas.mkPPMPayload(1);
+  ASSERT_EQ(canvas.mkPPMPayload(64), serial);
+  auto p6 = TempPath("rtc_canvas_short_p6.ppm");
+  auto p6Serial = TempPath("rtc_canvas_short_serial_p6.ppm");
+  canvas.writeFile(p6, ImageFormat::PPM_P6, 64);
+  canvas.writeFile(p6Serial, ImageFormat::PPM_P6, 1);
+  ASSERT_EQ(ReadAll(p6), ReadAll(p6Serial));
+  std::filesystem::remove(p6);
+  std::filesystem::remove(p6Serial);
+}
+
+TEST_F(CanvasTest, canvas_write_p6_to_pipe)
+{
+  // A pipe can't seek, the bands have to be streamed in order
+  auto canvas = Canvas<float>(301, 257);
+  FillGradient(canvas);
+  int fds[2];
+  ASSERT_EQ(::pipe(fds), 0);
+  auto data = std::string();
+  auto reader = std::thread([&]
+                            {
+    char buf[4096];
+    for (ssize_t n; (n = ::read(fds[0], buf, sizeof(buf))) > 0;)
+    {
+      data.append(buf, n);
+    } });
+  canvas.writeFile("/dev/fd/" + std::to_string(fds[1]), ImageFormat::PPM_P6, 4);
+  ::close(fds[1]);
+  reader.join();
+  ::close(fds[0]);
+  auto header = std::string("P6\n301 257\n255\n");
+  ASSERT_EQ(data.substr(0, header.size()), header);
+  auto expected = Quantized(canvas);
+  ASSERT_EQ(data.substr(header.size()), std::string(expected.begin(), expected.end()));
+}
+
+TEST_F(CanvasTest, canvas_buffer_is_aligned)
+{
+  auto canvas = Canvas<float>(33, 7);
+  ASSERT_EQ(reinterpret_cast<std::uintptr_t>(canvas.data()) % 64, 0u);
+  auto huge = Canvas<double>(1024, 512, PageSize::Huge);
+  ASSERT_EQ(reinterpret_cast<std::uintptr_t>(huge.data()) % (2 << 20), 0u);
+  ASSERT_EQ(huge.pixelAt(1023, 511), Color::Color<double>(0, 0, 0));
+}
+
+TEST_F(CanvasTest, canvas_copies_are_deep)
+{
+  auto canvas = Canvas<float>(4, 3);
+  canvas.writePixel(Color::Color<float>(1, 0, 0), 2, 1);
+  auto copy = canvas;
+  ASSERT_NE(copy.data(), canvas.data());
+  copy.writePixel(Color::Color<float>(0, 1, 0), 2, 1);
+  ASSERT_EQ(canvas.pixelAt(2, 1), Color::Color<float>(1, 0, 0));
+  ASSERT_EQ(copy.pixelAt(2, 1), Color::Color<float>(0, 1, 0));
+
+  canvas = copy;
+  ASSERT_EQ(canvas.pixelAt(2, 1), Color::Color<float>(0, 1, 0));
+}
+
+TEST_F(CanvasTest, canvas_move_leaves_source_empty)
+{
+  auto canvas = Canvas<float>(4, 3);
+  auto data = canvas.data();
+  auto moved = std::move(canvas);
+  ASSERT_EQ(moved.data(), data);
+  ASSERT_EQ(moved.width(), 4);
+  ASSERT_EQ(canvas.width(), 0);
+  ASSERT_EQ(canvas.height(), 0);
+  ASSERT_EQ(canvas.data(), nullptr);
+}
+
+namespace
+{
+  template <typename Layout>
+  void CheckLayout()
+  {
+    // Not a multiple of the tile size, so edge tiles are partial
+    auto rowMajor = Canvas<float>(37, 21);
+    auto other = Canvas<float, Layout>(37, 21);
+    FillGradient(rowMajor);
+    for (auto j = 0; j < 21; j++)
+    {
+      for (auto i = 0; i < 37; i++)
+      {
+        other.writePixel(rowMajor.pixelAt(i, j), i, j);
+      }
+    }
+    for (auto j = 0; j < 21; j++)
+    {
+      for (auto i = 0; i < 37; i++)
+      {
+        ASSERT_EQ(other.pixelAt(i, j), rowMajor.pixelAt(i, j));
+      }
+    }
+
+    auto rgb = std::vector<float>(3 * 37 * 21);
+    other.toRowMajor(rgb.data());
+    ASSERT_EQ(0, std::memcmp(rgb.data(), rowMajor.data(), rgb.size() * sizeof(float)));
+    auto back = Canvas<float, Layout>(37, 21);
+    back.fromRowMajor(rgb.data());
+    ASSERT_EQ(back.pixelAt(36, 20), rowMajor.pixelAt(36, 20));
+
+    ASSERT_EQ(other.mkPPMPayload(3), rowMajor.mkPPMPayload(1));
+    auto filename = TempPath("rtc_canvas_layout.ppm");
+    other.writeFile(filename, ImageFormat::PPM_P6, 3);
+    auto loaded = Canvas<float, Layout>(filename);
+    ASSERT_EQ(PPM::Quantize(loaded.pixelAt(20, 10).g()), PPM::Quantize(other.pixelAt(20, 10).g()));
+    std::filesystem::remove(filename);
+  }
+}
+
+TEST_F(CanvasTest, canvas_tiled_layout_matches_row_major)
+{
+  CheckLayout<CanvasLayout::Tiled<4, 4>>();
+  CheckLayout<CanvasLayout::Tiled<8, 2>>();
+}
+
+TEST_F(CanvasTest, canvas_morton_layout_matches_row_major)
+{
+  ASSERT_EQ(CanvasLayout::Morton(0b11, 0b01), 0b0111u);
+  CheckLayout<CanvasLayout::MortonTiled<8>>();
+}
+
+TEST_F(CanvasTest, canvas_tiles_own_their_cache_lines)
+{
+  using Layout = CanvasLayout::Tiled<4, 4>;
+  auto canvas = Canvas<float, Layout>(64, 64);
+  auto base = reinterpret_cast<std::uintptr_t>(canvas.data());
+  for (auto ty = 0; ty < 64; ty += 4)
+  {
+    for (auto tx = 0; tx < 64; tx += 4)
+    {
+      // A tile is one contiguous run of whole cache lines
+      auto first = base + Layout::Index(tx, ty, 64) * sizeof(float);
+      auto last = base + (Layout::Index(tx + 3, ty + 3, 64) + 3) * sizeof(float);
+      ASSERT_EQ(first % 64, 0u);
+      ASSERT_EQ(last % 64, 0u);
+    }
+  }
+}
+
+TEST_F(CanvasTest, canvas_add_sample_is_atomic)
+{
+  constexpr int threads = 64;
+  constexpr int samples = 1000;
+  auto canvas = Canvas<float>(4, 4);
+  auto workers = std::vector<std::thread>();
+  for (auto t = 0; t < threads; t++)
+  {
+    workers.emplace_back([&canvas, t]
+                         {
+      for (auto i = 0; i < samples; i++)
+      {
+        // Every thread hits every pixel
+        canvas.addSample(Color::Color<float>(1, 2, 0.5f), (t + i) % 4, i % 4);
+      } });
+  }
+  for (auto &w : workers)
+    w.join();
+  auto total = Color::Color<float>(0, 0, 0);
+  for (auto j = 0; j < 4; j++)
+  {
+    for (auto i = 0; i < 4; i++)
+    {
+      total = total + canvas.pixelAt(i, j);
+    }
+  }
+  ASSERT_EQ(total, Color::Color<float>(threads * samples, 2 * threads * samples, 0.5f * threads * samples));
+}
+
+TEST_F(CanvasTest, canvas_tile_owned_writes_need_no_locks)
+{
+  using Layout = CanvasLayout::Tiled<4, 4>;
+  auto canvas = Canvas<float, Layout>(32, 32);
+  auto workers = std::vector<std::thread>();
+  // One thread per 8 x 8 block of tiles
+  for (auto t = 0; t < 16; t++)
+  {
+    workers.emplace_back([&canvas, t]
+                         {
+      for (auto y = (t / 4) * 8; y < (t / 4 + 1) * 8; y++)
+      {
+        for (auto x = (t % 4) * 8; x < (t % 4 + 1) * 8; x++)
+        {
+          canvas.writePixel(Color::Color<float>(t, x, y), x, y);
+        }
+      } });
+  }
+  for (auto &w : workers)
+    w.join();
+  for (auto y = 0; y < 32; y++)
+  {
+    for (auto x = 0; x < 32; x++)
+    {
+      ASSERT_EQ(canvas.pixelAt(x, y), Color::Color<float>((y / 8) * 4 + x / 8, x, y));
+    }
+  }
+}
+
+TEST_F(CanvasTest, canvas_file_backed_resumes)
+{
+  auto path = TempPath("rtc_canvas_backing.rtc");
+  std::filesystem::remove(path);
+  {
+    auto canvas = Canvas<float, CanvasLayout::Tiled<4, 4>>(100, 60, FileBacking{path});
+    ASSERT_TRUE(canvas.fileBacked());
+    ASSERT_EQ(canvas.checkpointedProgress(), 0u);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(canvas.data()) % 64, 0u);
+    // New files start black
+    ASSERT_EQ(canvas.pixelAt(99, 59), Color::Color<float>(0, 0, 0));
+    canvas.writePixel(Color::Color<float>(0.25f, 0.5f, 1), 10, 20);
+    canvas.writePixel(Color::Color<float>(1, 0, 0), 99, 59);
+    canvas.checkpoint(42);
+  }
+  {
+    auto canvas = Canvas<float, CanvasLayout::Tiled<4, 4>>(100, 60, FileBacking{path});
+    ASSERT_EQ(canvas.checkpointedProgress(), 42u);
+    ASSERT_EQ(canvas.pixelAt(10, 20), Color::Color<float>(0.25f, 0.5f, 1));
+    ASSERT_EQ(canvas.pixelAt(99, 59), Color::Color<float>(1, 0, 0));
+
+    // Copies live in memory
+    auto copy = canvas;
+    ASSERT_FALSE(copy.fileBacked());
+    ASSERT_EQ(copy.pixelAt(10, 20), canvas.pixelAt(10, 20));
+  }
+  // Same size in bytes, different canvas
+  ASSERT_THROW((Canvas<float, CanvasLayout::MortonTiled<4>>(100, 60, FileBacking{path})), std::runtime_error);
+  ASSERT_THROW((Canvas<float>(10, 10, FileBacking{path})), std::runtime_error);
+  auto plain = Canvas<float>(2, 2);
+  ASSERT_THROW(plain.checkpoint(1), std::logic_error);
+  std::filesystem::remove(path);
+}
+
+TEST_F(CanvasTest, canvas_memory_is_accounted)
+{
+  auto before = CanvasMemory::HeapBytes();
+  {
+    auto canvas = Canvas<float>(64, 64);
+    ASSERT_GE(CanvasMemory::HeapBytes() - before, 3u * 64 * 64 * sizeof(float));
+    // Moves hand the bytes over, copies add their own
+    auto moved = std::move(canvas);
+    ASSERT_GE(CanvasMemory::HeapBytes() - before, 3u * 64 * 64 * sizeof(float));
+    auto copy = moved;
+    ASSERT_GE(CanvasMemory::HeapBytes() - before, 2u * 3 * 64 * 64 * sizeof(float));
+  }
+  ASSERT_EQ(CanvasMemory::HeapBytes(), before);
+}
@@ -0,0 +1,69 @@
+#include <app/canvas.h>
+#include <app/dirty_tiles.h>
+
+#include <vector>
+#include "gtest/gtest.h"
+
+class DirtyTilesTest : public ::testing::Test
+{
+
+protected:
+  virtual void SetUp(){};
+
+  virtual void TearDown(){};
+};
+
+TEST_F(DirtyTilesTest, starts_dirty_and_clears_on_take)
+{
+  auto tiles = DirtyTiles(100, 70);
+  auto rects = tiles.take();
+  // Two tile rows, each one merged run clipped to the canvas
+  ASSERT_EQ(rects, (std::vector<DirtyRect>{{0, 0, 100, 64}, {0, 64, 100, 6}}));
+  ASSERT_TRUE(tiles.take().empty());
+}
+
+TEST_F(DirtyTilesTest, merges_runs_within_a_tile_row)
+{
+  auto tiles = DirtyTiles(300, 200);
+  tiles.take();
+  tiles.mark(10, 10);
+  tiles.mark(70, 20);
+  tiles.mark(200, 20);
+  tiles.mark(299, 199);
+  auto rects = tiles.take();
+  ASSERT_EQ(rects, (std::vector<DirtyRect>{{0, 0, 128, 64}, {192, 0, 64, 64}, {256, 192, 44, 8}}));
+}
+
+TEST_F(DirtyTilesTest, mark_rect_covers_overlapping_tiles)
+{
+  auto tiles = DirtyTiles(256, 256);
+  tiles.take();
+  tiles.mark(60, 60, 10, 10);
+  auto rects = tiles.take();
+  ASSERT_EQ(rects, (std::vector<DirtyRect>{{0, 0, 128, 64}, {0, 64, 128, 64}}));
+  tiles.mark(0, 0, 0, 10);
+  ASSERT_TRUE(tiles.take().empty());
+}
+
+TEST_F(DirtyTilesTest, canvas_writes_mark_tiles)
+{
+  auto canvas = Canvas<float, CanvasLayout::Tiled<4, 4>>(130, 70);
+  canvas.takeDirtyRects();
+  canvas.writePixel(Color::Color<float>(1, 0.5f, 0.25f), 129, 69);
+  canvas.addSample(Color::Color<float>(0, 0, 1), 1, 1);
+  auto rects = canvas.takeDirtyRects();
+  ASSERT_EQ(rects, (std::vector<DirtyRect>{{0, 0, 64, 64}, {128, 64, 2, 6}}));
+
+  auto rgb = std::vector<float>(3 * 2 * 6);
+  canvas.copyRect(rects[1], rgb.data());
+  ASSERT_EQ(rgb[rgb.size() - 3], 1.f);
+  ASSERT_EQ(rgb[rgb.size() - 2], 0.5f);
+  ASSERT_EQ(rgb[rgb.size() - 1], 0.25f);
+
+  // Copies keep the flags, moves take them along
+  canvas.markDirty(0, 0, 1, 1);
+  auto copy = canvas;
+  ASSERT_EQ(copy.takeDirtyRects().size(), 1u);
+  auto moved = std::move(canvas);
+  ASSERT_EQ(moved.takeDirtyRects().size(), 1u);
+}
@@ -1,6 +1,10 @@
 #include "app/matrix.h"
 #include "app/tuple.h"
 
+#include <cstdint>
+#include <numbers>
+#include <type_traits>
+
 #include "gtest/gtest.h"
 
 using Tuple::Point;
@@ -319,4 +323,126 @@ TEST_F(MatrixTest, matrix_combined_transforms)
   auto p = Point(1., 0., 1.);
 
   ASSERT_EQ(transform * p, Point(15., 0., 7.));
-}
\ No newline at end of file
+}
+
+TEST_F(MatrixTest, matrix4_is_inline_and_aligned)
+{
+  static_assert(sizeof(Matrix::Matrix4<float>) == sizeof(float) * 16);
+  static_assert(sizeof(Matrix::Matrix4<double>) == sizeof(double) * 16);
+  static_assert(alignof(Matrix::Matrix4<float>) >= 32);
+  static_assert(alignof(Matrix::Matrix3<double>) >= 16);
+  static_assert(std::is_same_v<decltype(Matrix::Translation(1., 2., 3.)), Matrix::Matrix4<double>>);
+  static_assert(std::is_same_v<decltype(Matrix::RotationZ(1.f)), Matrix::Matrix4<float>>);
+
+  auto m = Matrix::Matrix4<float>();
+  ASSERT_EQ(reinterpret_cast<std::uintptr_t>(m.data()) % 32, 0);
+}
+
+TEST_F(MatrixTest, matrix4_matches_dynamic_matrix)
+{
+  auto values = std::vector<std::vector<double>>({{-2, -8, 3, 5},
+                                                  {-3, 1, 7, 3},
+                                                  {1, 2, -9, 6},
+                                                  {-6, 7, 7, -9}});
+  auto dynamic = Matrix::Matrix<double>(values);
+  auto fixed = Matrix::Matrix4<double>(dynamic);
+
+  ASSERT_EQ(fixed.submatrix(0, 0), Matrix::Matrix3<double>({{1, 7, 3},
+                                                            {2, -9, 6},
+                                                            {7, 7, -9}}));
+  ASSERT_EQ(fixed.cofactor(0, 3), dynamic.cofactor(0, 3));
+  ASSERT_EQ(fixed.det(), -4071);
+  ASSERT_EQ(Matrix::Matrix<double>(fixed.inverse()), dynamic.inverse());
+  ASSERT_EQ(Matrix::Matrix<double>(fixed * fixed), dynamic * dynamic);
+  ASSERT_EQ(Matrix::Matrix<double>(fixed.t()), dynamic.t());
+  ASSERT_EQ(fixed * Matrix::Identity<double>(), fixed);
+}
+
+TEST_F(MatrixTest, matrix4_combined_transforms)
+{
+  auto transform = Matrix::Identity<double>()
+                       .rotate_x(PI / 2.)
+                       .scale(5, 5, 5)
+                       .translate(10, 5, 7);
+  auto p = Point(1., 0., 1.);
+
+  ASSERT_EQ(transform * p, Point(15., 0., 7.));
+  ASSERT_EQ(transform.inverse() * Point(15., 0., 7.), p);
+}
+
+TEST_F(MatrixTest, matrix_closed_form_matches_cofactor)
+{
+  auto a = Matrix::Matrix4<double>({{-5, 2, 6, -8},
+                                    {1, -5, 1, 8},
+                                    {7, 7, -6, -7},
+                                    {1, -3, 7, 4}});
+  ASSERT_EQ(a.det(), 532);
+  ASSERT_EQ(a.det(), a.det_cofactor());
+  ASSERT_EQ(a.inverse(), a.inverse_cofactor());
+  ASSERT_EQ(a * a.inverse(), Matrix::Identity<double>());
+
+  auto b = Matrix::Matrix4<float>({{9, 3, 0, 9},
+                                   {-5, -2, -6, -3},
+                                   {-4, 9, 6, 4},
+                                   {-7, 6, 6, 2}});
+  ASSERT_EQ(b.inverse(), b.inverse_cofactor());
+
+  auto c = Matrix::Matrix3<double>({{1, 2, 6},
+                                    {-5, 8, -4},
+                                    {2, 6, 4}});
+  ASSERT_EQ(c.det(), -196);
+  ASSERT_EQ(c.inverse(), c.inverse_cofactor());
+  ASSERT_EQ(c * c.inverse(), c.identity());
+
+  auto d = Matrix::Matrix2<double>({{1, 5},
+                                    {-3, 2}});
+  ASSERT_EQ(d.det(), 17);
+  ASSERT_EQ(d * d.inverse(), d.identity());
+}
+
+TEST_F(MatrixTest, matrix_closed_form_singular_throws)
+{
+  auto a = Matrix::Matrix4<double>({{-4, 2, -2, -3},
+                                    {9, 6, 2, 6},
+                                    {0, -5, 1, -5},
+                                    {0, 0, 0, 0}});
+  ASSERT_EQ(a.det(), 0);
+  ASSERT_FALSE(a.invertible());
+  ASSERT_THROW(a.inverse(), std::runtime_error);
+  ASSERT_THROW(Matrix::Matrix3<double>().inverse(), std::runtime_error);
+}
+
+TEST_F(MatrixTest, matrix_constexpr_transforms)
+{
+  constexpr auto close = [](double a, double b)
+  { return (a - b) < 1e-12 && (b - a) < 1e-12; };
+  static_assert(close(constexpr_sin(PI / 6), 0.5));
+  static_assert(close(constexpr_cos(PI / 3), 0.5));
+  static_assert(close(constexpr_sin(-7.5 * PI), 1.0));
+  static_assert(close(constexpr_cos(10.0), -0.8390715290764524));
+
+  constexpr auto camera = Matrix::Identity<double>()
+                              .rotate_y(PI / 4.)
+                              .scale(2., 2., 2.)
+                              .translate(0., 0., -5.);
+  constexpr auto camera_inverse = camera.inverse();
+  static_assert(close(camera(2, 3), -5.));
+  static_assert(close(camera.det(), 8.));
+  static_assert(close(camera_inverse(0, 0), std::numbers::sqrt2 / 4.));
+
+  auto runtime = Matrix::RotationY(PI / 4.).scale(2., 2., 2.).translate(0., 0., -5.);
+  ASSERT_EQ(camera, runtime);
+  ASSERT_EQ(camera_inverse, runtime.inverse());
+}
+
+TEST_F(MatrixTest, matrix4_mult_by_tuple_returns_tuple)
+{
+  auto a = Matrix::Matrix4<double>({{1, 2, 3, 4},
+                                    {2, 4, 4, 2},
+                                    {8, 6, 4, 1},
+                                    {0, 0, 0, 1}});
+  auto b = Tuple::Tuple(1., 2., 3., 1.);
+  static_assert(std::is_same_v<decltype(a * b), Tuple::Tuple<double>>);
+  ASSERT_EQ(a * b, Tuple::Tuple(18., 24., 33., 1.));
+  ASSERT_EQ(Matrix::Matrix<double>(a * b), Matrix::Matrix<double>(a) * b);
+}
@@ -0,0 +1,175 @@
+#include <app/canvas.h>
+#include <app/ppm_reader.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_files.h"
+
+class PPMReaderTest : public ::testing::Test
+{
+
+protected:
+  virtual void SetUp(){};
+
+  virtual void TearDown(){};
+};
+
+namespace
+{
+  std::string WriteText(const std::string &name, const std::string &text)
+  {
+    auto filename = TempPath(name);
+    std::ofstream(filename, std::ios::binary) << text;
+    return filename;
+  }
+
+  void FillNoise(Canvas<float> &canvas)
+  {
+    for (auto j = 0; j < canvas.height(); j++)
+    {
+      for (auto i = 0; i < canvas.width(); i++)
+      {
+        canvas.writePixel(Color::Color((i * 7 + j) % 256 / 255.f, (i * j) % 97 / 96.f, i / (float)canvas.width()), i, j);
+      }
+    }
+  }
+}
+
+TEST_F(PPMReaderTest, dequantize_round_trips)
+{
+  auto f = PPM::DequantizeTable<float>(255);
+  auto d = PPM::DequantizeTable<double>(255);
+  for (auto v = 0; v < 256; v++)
+  {
+    ASSERT_EQ(PPM::Quantize(f[v]), v);
+    ASSERT_EQ(PPM::Quantize(d[v]), v);
+  }
+}
+
+TEST_F(PPMReaderTest, load_p3_and_p6_round_trip)
+{
+  // Large enough that the P3 text spans several reader buffers
+  auto canvas = Canvas<float>(211, 97);
+  FillNoise(canvas);
+  for (auto format : {ImageFormat::PPM_P3, ImageFormat::PPM_P6})
+  {
+    auto filename = TempPath("rtc_reader_round_trip.ppm");
+    canvas.writeFile(filename, format);
+    auto loaded = Canvas<float>(filename);
+    ASSERT_EQ(loaded.width(), 211);
+    ASSERT_EQ(loaded.height(), 97);
+    auto again = TempPath("rtc_reader_round_trip_again.ppm");
+    loaded.writeFile(again, format);
+    ASSERT_EQ(ReadAll(again), ReadAll(filename));
+
+    auto rows = 0;
+    auto header = PPM::StreamRows<float>(filename, [&](int y, const float *rgb)
+                                         {
+      ASSERT_EQ(y, rows++);
+      for (auto x = 0; x < 211; x++)
+      {
+        auto c = loaded.pixelAt(x, y);
+        ASSERT_EQ(rgb[3 * x], c.r());
+        ASSERT_EQ(rgb[3 * x + 1], c.g());
+        ASSERT_EQ(rgb[3 * x + 2], c.b());
+      } });
+    ASSERT_EQ(header.binary, format == ImageFormat::PPM_P6);
+    ASSERT_EQ(rows, 97);
+    std::filesystem::remove(filename);
+    std::filesystem::remove(again);
+  }
+}
+
+TEST_F(PPMReaderTest, load_p3_comments_and_whitespace)
+{
+  auto filename = WriteText("rtc_reader_comments.ppm",
+                            "P3 # magic\n# size\n2\t2\r\n15\n"
+                            "15 0 0    0 15 0\n\n0 0 15\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t15 15 15");
+  auto canvas = Canvas<double>(filename);
+  ASSERT_EQ(canvas.width(), 2);
+  ASSERT_EQ(canvas.height(), 2);
+  ASSERT_EQ(canvas.pixelAt(0, 0), Color::Color<double>(1, 0, 0));
+  ASSERT_EQ(canvas.pixelAt(1, 0), Color::Color<double>(0, 1, 0));
+  ASSERT_EQ(canvas.pixelAt(0, 1), Color::Color<double>(0, 0, 1));
+  ASSERT_EQ(canvas.pixelAt(1, 1), Color::Color<double>(1, 1, 1));
+  std::filesystem::remove(filename);
+}
+
+TEST_F(PPMReaderTest, scanner_carries_numbers_across_chunks)
+{
+  auto text = std::string();
+  auto expected = std::vector<uint16_t>();
+  for (auto i = 0; i < 500; i++)
+  {
+    expected.push_back(i * 131 % 65536);
+    text += std::to_string(expected.back()) + (i % 3 ? " " : "\n  ");
+  }
+  for (std::size_t chunk : {1, 3, 16, 17, 64})
+  {
+    auto scanner = PPM::P3Scanner(65535);
+    auto values = std::vector<uint16_t>(expected.size());
+    std::size_t got = 0;
+    for (std::size_t p = 0; p < text.size(); p += chunk)
+    {
+      const char *begin = text.data() + p;
+      auto end = text.data() + std::min(text.size(), p + chunk);
+      while (begin < end && got < values.size())
+        begin = scanner.scan(begin, end, values.data(), values.size(), got);
+    }
+    scanner.finish(values.data(), values.size(), got);
+    ASSERT_EQ(got, expected.size());
+    ASSERT_EQ(values, expected);
+  }
+}
+
+TEST_F(PPMReaderTest, load_p6_16_bit)
+{
+  auto data = std::string("P6\n1 1\n65535\n");
+  data += std::string("\xff\xff\x00\x00\x80\x00", 6);
+  auto filename = WriteText("rtc_reader_16.ppm", data);
+  auto canvas = Canvas<double>(filename);
+  ASSERT_EQ(canvas.pixelAt(0, 0), Color::Color<double>(1, 0, 32768 / 65535.0));
+  std::filesystem::remove(filename);
+}
+
+TEST_F(PPMReaderTest, malformed_files_throw)
+{
+  auto cases = std::vector<std::string>{
+      "P5\n1 1\n255\n0",
+      "P3\n2 1\n255\n0 0 0 0 0",
+      "P3\n1 1\n255\n0 256 0",
+      "P3\n1 1\n255\n0 x 0",
+      "P3\n1 -1\n255\n",
+      std::string("P6\n2 1\n255\n\0\0\0", 15),
+  };
+  for (const auto &text : cases)
+  {
+    auto filename = WriteText("rtc_reader_bad.ppm", text);
+    ASSERT_THROW(Canvas<float>{filename}, std::runtime_error) << text;
+    ASSERT_THROW(PPM::StreamRows<float>(filename, [](int, const float *) {}), std::runtime_error) << text;
+    std::filesystem::remove(filename);
+  }
+}
+
+TEST_F(PPMReaderTest, oversized_headers_throw_before_allocating)
+{
+  auto cases = std::vector<std::string>{
+      "P6\n700000000 700000000\n255\n",
+      "P6\n1 1\n65535\n\x01\x02\x03",
+      "P3\n700000000 700000000\n255\n0 0 0",
+      "P3\n2 1\n255\n0 0 0 0 0",
+  };
+  for (const auto &text : cases)
+  {
+    auto filename = WriteText("rtc_reader_huge.ppm", text);
+    ASSERT_THROW(Canvas<float>{filename}, std::runtime_error) << text;
+    std::filesystem::remove(filename);
+  }
+  // The last P3 sample needs no space after it
+  auto filename = WriteText("rtc_reader_huge.ppm", "P3\n1 1\n255\n255 0 255");
+  ASSERT_EQ(Canvas<float>{filename}.pixelAt(0, 0), Color::Color<float>(1, 0, 1));
+  std::filesystem::remove(filename);
+}
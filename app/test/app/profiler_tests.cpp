@@ -0,0 +1,93 @@
+#include <app/profiler.h>
+
+#include <algorithm>
+#include <thread>
+#include "gtest/gtest.h"
+
+class ProfilerTest : public ::testing::Test
+{
+
+protected:
+  virtual void SetUp(){};
+
+  virtual void TearDown(){};
+};
+
+template <typename Stats>
+static Stats Find(const std::vector<Stats> &all, const std::string &name)
+{
+  auto it = std::find_if(all.begin(), all.end(), [&](const Stats &s)
+                         { return s.name == name; });
+  EXPECT_NE(it, all.end()) << name;
+  return it == all.end() ? Stats{} : *it;
+}
+
+TEST_F(ProfilerTest, stages_sum_per_frame)
+{
+  auto &profiler = Profiling::Profiler::Instance();
+  profiler.record("test stage", 0.002);
+  profiler.record("test stage", 0.003);
+  profiler.endFrame(0.016);
+  auto stage = Find(profiler.stages(), "test stage");
+  ASSERT_DOUBLE_EQ(stage.seconds, 0.005);
+  ASSERT_EQ(stage.calls, 2u);
+  ASSERT_GT(stage.averageSeconds, 0.0);
+  ASSERT_LT(stage.averageSeconds, 0.005);
+
+  // A frame without records reads as zero
+  profiler.endFrame(0.016);
+  stage = Find(profiler.stages(), "test stage");
+  ASSERT_EQ(stage.seconds, 0.0);
+  ASSERT_EQ(stage.calls, 0u);
+}
+
+TEST_F(ProfilerTest, counters_give_rates)
+{
+  auto &profiler = Profiling::Profiler::Instance();
+  for (int i = 0; i < 50; i++)
+  {
+    profiler.count("test counter", 100);
+    profiler.endFrame(0.01);
+  }
+  auto counter = Find(profiler.counters(), "test counter");
+  ASSERT_EQ(counter.lastFrame, 100u);
+  // Smoothed towards 10000/s
+  ASSERT_NEAR(counter.perSecond, 10000.0, 100.0);
+}
+
+TEST_F(ProfilerTest, scoped_timer_from_threads)
+{
+  auto &profiler = Profiling::Profiler::Instance();
+  auto threads = std::vector<std::thread>();
+  for (int t = 0; t < 4; t++)
+  {
+    threads.emplace_back([]()
+                         {
+                           for (int i = 0; i < 10; i++)
+                             Profiling::ScopedTimer timer("test timer"); });
+  }
+  for (auto &t : threads)
+    t.join();
+  profiler.endFrame(0.016);
+  auto stage = Find(profiler.stages(), "test timer");
+  ASSERT_EQ(stage.calls, 40u);
+  ASSERT_GE(stage.seconds, 0.0);
+}
+
+TEST_F(ProfilerTest, macros_compile_out)
+{
+  auto &profiler = Profiling::Profiler::Instance();
+  {
+    RTC_PROFILE_SCOPE("test macro");
+    RTC_PROFILE_COUNT("test macro count", 1);
+  }
+  profiler.endFrame(0.016);
+  auto stages = profiler.stages();
+  auto found = std::any_of(stages.begin(), stages.end(), [](auto &s)
+                           { return s.name == "test macro"; });
+#if defined(RTC_PROFILING)
+  ASSERT_TRUE(found);
+#else
+  ASSERT_FALSE(found);
+#endif
+}
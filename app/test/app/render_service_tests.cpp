@@ -0,0 +1,154 @@
+#include <app/render_service.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include "gtest/gtest.h"
+
+class RenderServiceTest : public ::testing::Test
+{
+
+protected:
+  virtual void SetUp(){};
+
+  virtual void TearDown(){};
+};
+
+template <typename Layout>
+static void DrainAll(RenderService<float> &service, Canvas<float, Layout> &canvas)
+{
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!service.finished() && std::chrono::steady_clock::now() < deadline)
+  {
+    if (service.drain(canvas) == 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+TEST_F(RenderServiceTest, renders_every_pixel)
+{
+  auto service = RenderService<float>(100, 70, 3, 4);
+  auto canvas = Canvas<float, CanvasLayout::Tiled<4, 4>>(100, 70);
+  service.start([](float u, float v)
+                { return Color::Color<float>(std::floor(u) / 100.f, std::floor(v) / 70.f, 0.5f); });
+  ASSERT_EQ(service.tileCount(), 12u);
+  DrainAll(service, canvas);
+  ASSERT_TRUE(service.finished());
+  for (int y = 0; y < 70; y++)
+  {
+    for (int x = 0; x < 100; x++)
+    {
+      ASSERT_EQ(canvas.pixelAt(x, y), Color::Color<float>(x / 100.f, y / 70.f, 0.5f));
+    }
+  }
+}
+
+TEST_F(RenderServiceTest, reduced_resolution_fills_blocks)
+{
+  auto service = RenderService<float>(70, 40, 2);
+  auto canvas = Canvas<float>(70, 40);
+  service.start([](float u, float v)
+                { return Color::Color<float>(u, v, 0); },
+                8);
+  DrainAll(service, canvas);
+  ASSERT_TRUE(service.finished());
+  for (int y = 0; y < 40; y++)
+  {
+    for (int x = 0; x < 70; x++)
+    {
+      // Sampled in the middle of each block, clipped ones at the edges too
+      auto bx = x / 8 * 8;
+      auto by = y / 8 * 8;
+      auto cx = bx + std::min(8, 70 - bx) / 2;
+      ASSERT_EQ(canvas.pixelAt(x, y), Color::Color<float>(cx, by + 4, 0));
+    }
+  }
+  auto stats = service.takeStats();
+  ASSERT_EQ(stats.samples, 9u * 5u);
+  ASSERT_GE(stats.seconds, 0.0);
+  ASSERT_EQ(service.takeStats().samples, 0u);
+}
+
+TEST_F(RenderServiceTest, restart_drops_stale_tiles)
+{
+  auto service = RenderService<float>(64, 64, 2);
+  auto canvas = Canvas<float>(64, 64);
+  auto release = std::atomic<bool>(false);
+  service.start([&release](float, float)
+                {
+                  while (!release.load())
+                    std::this_thread::yield();
+                  return Color::Color<float>(1, 0, 0); });
+  service.start([](float, float)
+                { return Color::Color<float>(0, 0, 1); });
+  release = true;
+  DrainAll(service, canvas);
+  ASSERT_TRUE(service.finished());
+  ASSERT_EQ(service.tilesDone(), 4u);
+  for (int y = 0; y < 64; y++)
+  {
+    for (int x = 0; x < 64; x++)
+    {
+      ASSERT_EQ(canvas.pixelAt(x, y), Color::Color<float>(0, 0, 1));
+    }
+  }
+}
+
+TEST_F(RenderServiceTest, cancel_stops_rendering)
+{
+  auto service = RenderService<float>(256, 256, 2);
+  auto canvas = Canvas<float>(256, 256);
+  auto shaded = std::atomic<int>(0);
+  service.start([&shaded](float, float)
+                {
+                  shaded++;
+                  std::this_thread::sleep_for(std::chrono::microseconds(10));
+                  return Color::Color<float>(1, 1, 1); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  service.cancel();
+  service.drain(canvas);
+  ASSERT_EQ(service.tilesDone(), 0u);
+  // Workers give up within a row of noticing
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  auto after = shaded.load();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_EQ(shaded.load(), after);
+  ASSERT_LT(after, 256 * 256);
+}
+
+TEST_F(RenderServiceTest, accumulates_samples_at_full_resolution)
+{
+  auto service = RenderService<float>(40, 40, 3, 4);
+  auto canvas = Canvas<float>(40, 40);
+  auto shader = [](float u, float v)
+  { return Color::Color<float>(u - std::floor(u), std::floor(v), 1); };
+  // A reduced resolution pass takes one sample per block whatever is asked
+  service.start(shader, 2, 8);
+  ASSERT_EQ(service.tileCount(), 4u);
+  // The first image leaves samples behind, the second must not see them
+  service.start(shader, 1, 8);
+  DrainAll(service, canvas);
+  service.start(shader, 1, 8);
+  ASSERT_EQ(service.tileCount(), 4u * 8u);
+  service.takeStats();
+  DrainAll(service, canvas);
+  ASSERT_TRUE(service.finished());
+  ASSERT_EQ(service.takeStats().samples, 40u * 40u * 8u);
+
+  float mean = 0.f;
+  for (int i = 0; i < 8; i++)
+    mean += Sampling::SampleOffset(i).first;
+  mean /= 8;
+  for (int y = 0; y < 40; y++)
+  {
+    for (int x = 0; x < 40; x++)
+    {
+      auto c = canvas.pixelAt(x, y);
+      ASSERT_NEAR(c.r(), mean, 1e-5f);
+      ASSERT_EQ(c.g(), y);
+      ASSERT_EQ(c.b(), 1);
+    }
+  }
+}
@@ -0,0 +1,216 @@
+#include <app/streaming_canvas.h>
+
+#include <filesystem>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "test_files.h"
+
+class StreamingCanvasTest : public ::testing::Test
+{
+
+protected:
+  virtual void SetUp(){};
+
+  virtual void TearDown(){};
+};
+
+namespace
+{
+  Color::Color<float> ColorAt(int x, int y)
+  {
+    return Color::Color<float>(x % 256 / 255.f, y % 256 / 255.f, (x * y) % 17 / 16.f);
+  }
+}
+
+TEST_F(StreamingCanvasTest, matches_canvas_output)
+{
+  constexpr int w = 123;
+  constexpr int h = 45;
+  auto reference = Canvas<float>(w, h);
+  for (auto y = 0; y < h; y++)
+  {
+    for (auto x = 0; x < w; x++)
+    {
+      reference.writePixel(ColorAt(x, y), x, y);
+    }
+  }
+
+  for (auto format : {ImageFormat::PPM_P3, ImageFormat::PPM_P6, ImageFormat::QOI})
+  {
+    auto expected = TempPath("rtc_streaming_expected");
+    auto actual = TempPath("rtc_streaming_actual");
+    reference.writeFile(expected, format);
+    {
+      auto canvas = StreamingCanvas<float>(actual, w, h, format, 4);
+      // Threads take interleaved rows, so bands complete out of order
+      auto workers = std::vector<std::thread>();
+      for (auto t = 0; t < 3; t++)
+      {
+        workers.emplace_back([&canvas, t]
+                             {
+          for (auto y = t; y < h; y += 3)
+          {
+            for (auto x = 0; x < w; x++)
+            {
+              canvas.writePixel(ColorAt(x, y), x, y);
+            }
+          } });
+      }
+      for (auto &worker : workers)
+        worker.join();
+      ASSERT_EQ(canvas.rowsWritten(), h);
+      ASSERT_EQ(canvas.residentBands(), 0u);
+      canvas.close();
+    }
+    ASSERT_EQ(ReadAll(actual), ReadAll(expected));
+    std::filesystem::remove(expected);
+    std::filesystem::remove(actual);
+  }
+}
+
+TEST_F(StreamingCanvasTest, bands_are_released_once_written)
+{
+  auto filename = TempPath("rtc_streaming_bands.ppm");
+  auto canvas = StreamingCanvas<double>(filename, 64, 64, ImageFormat::PPM_P6, 8);
+  for (auto y = 0; y < 64; y++)
+  {
+    for (auto x = 0; x < 64; x++)
+    {
+      canvas.writePixel(Color::Color<double>(0.5, 0.5, 0.5), x, y);
+    }
+    // At most the band being filled stays in memory
+    ASSERT_LE(canvas.residentBands(), 1u);
+    ASSERT_EQ(canvas.rowsWritten(), (y + 1) / 8 * 8);
+  }
+  canvas.close();
+  ASSERT_EQ(std::filesystem::file_size(filename), MakePPMHeader(ImageFormat::PPM_P6, 64, 64).size() + 64 * 64 * 3);
+  std::filesystem::remove(filename);
+}
+
+TEST_F(StreamingCanvasTest, close_with_missing_rows_throws)
+{
+  auto filename = TempPath("rtc_streaming_missing.ppm");
+  auto canvas = StreamingCanvas<float>(filename, 8, 8, ImageFormat::PPM_P6, 4);
+  for (auto y = 0; y < 5; y++)
+  {
+    for (auto x = 0; x < 8; x++)
+    {
+      canvas.writePixel(ColorAt(x, y), x, y);
+    }
+  }
+  ASSERT_EQ(canvas.rowsWritten(), 4);
+  ASSERT_THROW(canvas.close(), std::runtime_error);
+  std::filesystem::remove(filename);
+}
+
+TEST_F(StreamingCanvasTest, duplicate_writes_are_rejected)
+{
+  auto filename = TempPath("rtc_streaming_duplicate.ppm");
+  auto canvas = StreamingCanvas<float>(filename, 8, 8, ImageFormat::PPM_P6, 4);
+  // Twice in a band still being filled: without the check the band would
+  // complete one pixel early
+  canvas.writePixel(ColorAt(0, 0), 0, 0);
+  ASSERT_THROW(canvas.writePixel(Color::Color<float>(1, 1, 1), 0, 0), std::logic_error);
+  for (auto y = 0; y < 8; y++)
+  {
+    for (auto x = 0; x < 8; x++)
+    {
+      if (x > 0 || y > 0)
+        canvas.writePixel(ColorAt(x, y), x, y);
+    }
+    // The first band is only written out once its real last pixel is in
+    ASSERT_EQ(canvas.rowsWritten(), (y + 1) / 4 * 4);
+  }
+  // Into a band already written out
+  ASSERT_THROW(canvas.writePixel(ColorAt(3, 2), 3, 2), std::logic_error);
+  ASSERT_EQ(canvas.residentBands(), 0u);
+  canvas.close();
+
+  auto reference = Canvas<float>(8, 8);
+  for (auto y = 0; y < 8; y++)
+  {
+    for (auto x = 0; x < 8; x++)
+    {
+      reference.writePixel(ColorAt(x, y), x, y);
+    }
+  }
+  auto expected = TempPath("rtc_streaming_duplicate_ref.ppm");
+  reference.writeFile(expected, ImageFormat::PPM_P6);
+  ASSERT_EQ(ReadAll(filename), ReadAll(expected));
+  std::filesystem::remove(filename);
+  std::filesystem::remove(expected);
+}
+
+TEST_F(StreamingCanvasTest, duplicate_write_racing_a_flush)
+{
+  // Narrow one-row bands, so a good share of the time goes to flushing
+  constexpr int w = 4;
+  constexpr int h = 4096;
+  auto filename = TempPath("rtc_streaming_duplicate_race.ppm");
+  auto canvas = StreamingCanvas<float>(filename, w, h, ImageFormat::PPM_P6, 1);
+  canvas.writePixel(ColorAt(0, 0), 0, 0);
+  auto done = std::atomic<bool>(false);
+  auto rejected = std::atomic<int>(0);
+  // Hammer the first pixel of whichever band is being finished, so
+  // duplicates land while that band is flushed and freed
+  auto duplicates = std::vector<std::thread>();
+  for (auto t = 0; t < 3; t++)
+  {
+    duplicates.emplace_back([&]
+                            {
+      while (!done.load(std::memory_order_acquire))
+      {
+        auto y = std::min(canvas.rowsWritten(), h - 1);
+        try
+        {
+          canvas.writePixel(ColorAt(0, y), 0, y);
+        }
+        catch (const std::logic_error &)
+        {
+          rejected.fetch_add(1, std::memory_order_relaxed);
+        }
+      } });
+  }
+  // Their first tries are at (0, 0), already written
+  while (rejected.load(std::memory_order_relaxed) == 0)
+    std::this_thread::yield();
+  for (auto y = 0; y < h; y++)
+  {
+    // A duplicate thread may win the first pixel of later rows, the row's
+    // own write is then the rejected one
+    if (y > 0)
+    {
+      try
+      {
+        canvas.writePixel(ColorAt(0, y), 0, y);
+      }
+      catch (const std::logic_error &)
+      {
+      }
+    }
+    for (auto x = 1; x < w; x++)
+    {
+      canvas.writePixel(ColorAt(x, y), x, y);
+    }
+  }
+  done.store(true, std::memory_order_release);
+  for (auto &t : duplicates)
+    t.join();
+  ASSERT_EQ(canvas.residentBands(), 0u);
+  canvas.close();
+
+  auto reference = Canvas<float>(w, h);
+  for (auto y = 0; y < h; y++)
+  {
+    for (auto x = 0; x < w; x++)
+    {
+      reference.writePixel(ColorAt(x, y), x, y);
+    }
+  }
+  auto expected = TempPath("rtc_streaming_duplicate_race_ref.ppm");
+  reference.writeFile(expected, ImageFormat::PPM_P6);
+  ASSERT_EQ(ReadAll(filename), ReadAll(expected));
+  std::filesystem::remove(filename);
+  std::filesystem::remove(expected);
+}
@@ -0,0 +1,22 @@
+#ifndef TEST_FILES_H
+#define TEST_FILES_H
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+// Scratch files for the tests that write images out and read them back
+
+inline std::string ReadAll(const std::string &filename)
+{
+  std::ifstream in(filename, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+inline std::string TempPath(const std::string &name)
+{
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+#endif // TEST_FILES_H
@@ -0,0 +1,63 @@
+#include <app/tile_queue.h>
+
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+
+class TileQueueTest : public ::testing::Test
+{
+
+protected:
+  virtual void SetUp(){};
+
+  virtual void TearDown(){};
+};
+
+TEST_F(TileQueueTest, fifo_until_full)
+{
+  auto queue = TileQueue<int>(3);
+  ASSERT_EQ(queue.capacity(), 4u);
+  for (int i = 0; i < 4; i++)
+    ASSERT_TRUE(queue.push(i));
+  int extra = 4;
+  ASSERT_FALSE(queue.push(extra));
+  for (int i = 0; i < 4; i++)
+    ASSERT_EQ(queue.pop(), i);
+  ASSERT_FALSE(queue.pop().has_value());
+}
+
+TEST_F(TileQueueTest, many_producers_one_consumer)
+{
+  constexpr int producers = 4;
+  constexpr int perProducer = 2000;
+  auto queue = TileQueue<int>(64);
+  auto threads = std::vector<std::thread>();
+  for (int p = 0; p < producers; p++)
+  {
+    threads.emplace_back([&queue, p]()
+                         {
+                           for (int i = 0; i < perProducer; i++)
+                           {
+                             int v = p * perProducer + i;
+                             while (!queue.push(v))
+                               std::this_thread::yield();
+                           } });
+  }
+  auto seen = std::vector<int>(producers * perProducer);
+  auto last = std::vector<int>(producers, -1);
+  for (int n = 0; n < producers * perProducer;)
+  {
+    auto v = queue.pop();
+    if (!v)
+      continue;
+    seen[*v]++;
+    // Each producer's values come out in the order it pushed them
+    ASSERT_GT(*v % perProducer, last[*v / perProducer]);
+    last[*v / perProducer] = *v % perProducer;
+    n++;
+  }
+  for (auto &t : threads)
+    t.join();
+  for (auto s : seen)
+    ASSERT_EQ(s, 1);
+}
@@ -0,0 +1,88 @@
+#include "app/transform_batch.h"
+#include "app/tuple.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using Matrix::SimdLevel;
+
+class TransformBatchTest : public ::testing::Test
+{
+protected:
+  virtual void SetUp(){};
+  virtual void TearDown(){};
+};
+
+TEST_F(TransformBatchTest, batch_matches_single_transform)
+{
+  auto runTest = []<typename T>(T)
+  {
+    auto m = Matrix::RotationX(static_cast<T>(PI / 3)).scale(2, 3, 4).translate(10, -5, 7);
+    // Odd size so every SIMD path also runs its scalar tail
+    constexpr std::size_t n = 37;
+    std::vector<T> x(n), y(n), z(n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+      x[i] = static_cast<T>(i);
+      y[i] = static_cast<T>(i) * -0.5f;
+      z[i] = static_cast<T>(n - i);
+    }
+
+    for (auto level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2})
+    {
+      std::vector<T> px(n), py(n), pz(n), vx(n), vy(n), vz(n);
+      Matrix::TransformPoints(m, {x.data(), y.data(), z.data(), n}, {px.data(), py.data(), pz.data(), n}, level);
+      Matrix::TransformVectors(m, {x.data(), y.data(), z.data(), n}, {vx.data(), vy.data(), vz.data(), n}, level);
+      for (std::size_t i = 0; i < n; i++)
+      {
+        EXPECT_EQ(Tuple::Point(px[i], py[i], pz[i]), m * Tuple::Point(x[i], y[i], z[i]));
+        EXPECT_EQ(Tuple::Vector(vx[i], vy[i], vz[i]), m * Tuple::Vector(x[i], y[i], z[i]));
+      }
+    }
+  };
+  runTest(0.0f);
+  runTest(0.0);
+}
+
+TEST_F(TransformBatchTest, batch_transform_in_place)
+{
+  std::vector<double> x{1, 2, 3, 4, 5}, y{0, 0, 0, 0, 0}, z{1, 1, 1, 1, 1};
+  auto span = Matrix::TupleSpan<double>{x.data(), y.data(), z.data(), x.size()};
+  Matrix::TransformPoints(Matrix::Translation(1., 2., 3.), span, span);
+  for (std::size_t i = 0; i < x.size(); i++)
+  {
+    EXPECT_EQ(Tuple::Point(x[i], y[i], z[i]), Tuple::Point(i + 2., 2., 4.));
+  }
+}
+
+TEST_F(TransformBatchTest, batch_requires_affine_matrices)
+{
+  ASSERT_TRUE(Matrix::IsAffine(Matrix::Translation(1.f, 2.f, 3.f)));
+  ASSERT_TRUE(Matrix::IsAffine(Matrix::Identity<double>().rotate_x(0.5).scale(1., 2., 3.)));
+  // A perspective projection puts z into w
+  auto projection = Matrix::Identity<float>();
+  projection(3, 2) = 1.f;
+  projection(3, 3) = 0.f;
+  ASSERT_FALSE(Matrix::IsAffine(projection));
+}
+
+TEST_F(TransformBatchTest, normals_take_the_inverse_transpose)
+{
+  // Translated, so the inverse-transpose has a nonzero bottom row
+  auto m = Matrix::Translation(1., 2., 3.).scale(2., 2., 4.);
+  auto normal = m.inverse().t();
+  ASSERT_FALSE(Matrix::IsAffine(normal));
+  std::vector<double> x{1, 0, 0, 1, 2}, y{0, 1, 0, 1, -1}, z{0, 0, 1, 1, 3};
+  for (auto level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2})
+  {
+    std::vector<double> nx(x.size()), ny(x.size()), nz(x.size());
+    Matrix::TransformVectors(normal, {x.data(), y.data(), z.data(), x.size()},
+                             {nx.data(), ny.data(), nz.data(), x.size()}, level);
+    for (std::size_t i = 0; i < x.size(); i++)
+    {
+      auto expected = normal * Tuple::Vector(x[i], y[i], z[i]);
+      EXPECT_EQ(Tuple::Vector(nx[i], ny[i], nz[i]), Tuple::Vector(expected.x(), expected.y(), expected.z()));
+    }
+  }
+}
@@ -0,0 +1,62 @@
+#include "app/transform_expr.h"
+#include "app/tuple.h"
+
+#include <type_traits>
+
+#include "gtest/gtest.h"
+
+using Tuple::Point;
+
+class TransformExprTest : public ::testing::Test
+{
+protected:
+  virtual void SetUp(){};
+  virtual void TearDown(){};
+};
+
+TEST_F(TransformExprTest, lazy_chain_matches_eager_chain)
+{
+  Matrix::Matrix4<double> lazy = Matrix::Lazy<double>()
+                                     .rotate_x(PI / 2.)
+                                     .shear(1., 0., 0., 1., 0., 0.)
+                                     .rotate_y(PI / 3.)
+                                     .scale(5, 5, 5)
+                                     .rotate_z(PI / 7.)
+                                     .translate(10, 5, 7);
+  auto eager = Matrix::Identity<double>()
+                   .rotate_x(PI / 2.)
+                   .shear(1., 0., 0., 1., 0., 0.)
+                   .rotate_y(PI / 3.)
+                   .scale(5, 5, 5)
+                   .rotate_z(PI / 7.)
+                   .translate(10, 5, 7);
+  ASSERT_EQ(lazy, eager);
+
+  auto seed = Matrix::Translation(1., 2., 3.);
+  ASSERT_EQ(Matrix::Lazy(seed).scale(2., 1., 1.).eval(), seed.scale(2., 1., 1.));
+  ASSERT_EQ(Matrix::Lazy<double>().rotate_x(PI / 2.).scale(5, 5, 5).translate(10, 5, 7).eval() * Point(1., 0., 1.),
+            Point(15., 0., 7.));
+}
+
+TEST_F(TransformExprTest, lazy_chain_folds_consecutive_ops)
+{
+  auto single = Matrix::Lazy<double>().rotate_x(0.5).translate(1., 2., 3.);
+  auto folded = Matrix::Lazy<double>().rotate_x(0.2).rotate_x(0.3).translate(1., 0., 0.).translate(0., 2., 3.);
+  static_assert(std::is_same_v<decltype(single), decltype(folded)>);
+  ASSERT_EQ(single.eval(), folded.eval());
+
+  auto scaled = Matrix::Lazy<double>().scale(2., 2., 2.).scale(1., 3., 0.5);
+  static_assert(std::is_same_v<decltype(scaled)::prev_type, Matrix::TransformSeed<double>>);
+  ASSERT_EQ(scaled.eval(), Matrix::Scaling(2., 6., 1.));
+
+  // Shears and rotations about different axes never fold
+  auto unfolded = Matrix::Lazy<double>().rotate_x(0.2).rotate_y(0.3);
+  static_assert(!std::is_same_v<decltype(unfolded)::prev_type, Matrix::TransformSeed<double>>);
+}
+
+TEST_F(TransformExprTest, lazy_chain_is_constexpr)
+{
+  constexpr Matrix::Matrix4<double> m = Matrix::Lazy<double>().rotate_y(PI / 4.).translate(0., 0., -5.);
+  static_assert(m(2, 3) == -5.);
+  ASSERT_EQ(m, Matrix::RotationY(PI / 4.).translate(0., 0., -5.));
+}
@@ -0,0 +1,43 @@
+#include "app/transform.h"
+#include "app/tuple.h"
+
+#include "gtest/gtest.h"
+
+using Tuple::Point;
+
+class TransformTest : public ::testing::Test
+{
+protected:
+  virtual void SetUp(){};
+  virtual void TearDown(){};
+};
+
+TEST_F(TransformTest, transform_caches_inverse)
+{
+  auto t = Matrix::Transform<double>(Matrix::Translation(5., -3., 2.));
+  ASSERT_FALSE(t.cached());
+  ASSERT_EQ(t.inverse() * Point(-3., 4., 5.), Point(-8., 7., 3.));
+  ASSERT_TRUE(t.cached());
+
+  auto first = &t.inverse();
+  ASSERT_EQ(&t.inverse(), first);
+  ASSERT_EQ(t.inverse_transpose(), Matrix::Translation(5., -3., 2.).inverse().t());
+  ASSERT_TRUE(t.cached());
+}
+
+TEST_F(TransformTest, transform_invalidated_by_builders)
+{
+  auto t = Matrix::Transform<double>();
+  t.inverse();
+  t.rotate_x(PI / 2.).scale(5, 5, 5).translate(10, 5, 7);
+  ASSERT_FALSE(t.cached());
+
+  auto expected = Matrix::Identity<double>().rotate_x(PI / 2.).scale(5, 5, 5).translate(10, 5, 7);
+  ASSERT_EQ(t.matrix(), expected);
+  ASSERT_EQ(t.inverse(), expected.inverse());
+  ASSERT_EQ(t.inverse_transpose(), expected.inverse().t());
+
+  t.shear(1., 0., 0., 0., 0., 0.);
+  ASSERT_FALSE(t.cached());
+  ASSERT_THROW(t.set(Matrix::Scaling(0., 1., 1.)).inverse(), std::runtime_error);
+}
@@ -0,0 +1,88 @@
+#include <app/tuple_batch.h>
+
+#include <type_traits>
+#include <vector>
+#include "gtest/gtest.h"
+
+using Tuple::LaneMask;
+using Tuple::TupleBatch;
+
+class TupleBatchTest : public ::testing::Test
+{
+
+protected:
+  virtual void SetUp(){};
+
+  virtual void TearDown(){};
+};
+
+TEST_F(TupleBatchTest, batch_gather_scatter_round_trip)
+{
+  auto src = std::vector{Tuple::Point(1., 2., 3.),
+                         Tuple::Vector(4., 5., 6.),
+                         Tuple::Point(-1., 0., 1.)};
+  auto batch = TupleBatch<double, 4>::Gather(src.data(), src.size());
+  EXPECT_EQ(batch.at(1), src[1]);
+  EXPECT_EQ(batch.at(3), Tuple::Tuple(0., 0., 0., 0.));
+
+  auto dst = std::vector<Tuple::Tuple<double>>(src.size(), Tuple::Point(9., 9., 9.));
+  batch.Scatter(dst.data(), dst.size());
+  for (std::size_t i = 0; i < src.size(); i++)
+  {
+    EXPECT_EQ(dst[i], src[i]);
+  }
+}
+
+TEST_F(TupleBatchTest, batch_matches_tuple_math)
+{
+  auto runTest = []<typename T, std::size_t N>(T, std::integral_constant<std::size_t, N>)
+  {
+    auto a = TupleBatch<T, N>();
+    auto b = TupleBatch<T, N>();
+    for (std::size_t i = 0; i < N; i++)
+    {
+      a.set(i, Tuple::Vector(static_cast<T>(i + 1), static_cast<T>(2), static_cast<T>(3)));
+      b.set(i, Tuple::Vector(static_cast<T>(2), static_cast<T>(i), static_cast<T>(4)));
+    }
+    auto sum = a + b;
+    auto diff = a - b;
+    auto scaled = a * static_cast<T>(3);
+    auto dots = a.dot(b);
+    auto crossed = a.cross(b);
+    auto unit = a.normalize();
+    for (std::size_t i = 0; i < N; i++)
+    {
+      EXPECT_EQ(sum.at(i), a.at(i) + b.at(i));
+      EXPECT_EQ(diff.at(i), a.at(i) - b.at(i));
+      EXPECT_EQ(scaled.at(i), a.at(i) * static_cast<T>(3));
+      EXPECT_FLOAT_EQ(dots[i], a.at(i).dot(b.at(i)));
+      EXPECT_EQ(crossed.at(i), a.at(i).cross(b.at(i)));
+      EXPECT_EQ(unit.at(i), a.at(i).normalize());
+    }
+  };
+  runTest(0.0f, std::integral_constant<std::size_t, 4>());
+  runTest(0.0f, std::integral_constant<std::size_t, 8>());
+  runTest(0.0, std::integral_constant<std::size_t, 16>());
+}
+
+TEST_F(TupleBatchTest, batch_masked_operations)
+{
+  auto a = TupleBatch<float, 4>::Broadcast(Tuple::Vector(1.f, 0.f, 0.f));
+  auto b = TupleBatch<float, 4>::Broadcast(Tuple::Vector(0.f, 1.f, 0.f));
+  auto mask = LaneMask<4>{true, false, true, false};
+
+  auto sum = a.add(b, mask);
+  EXPECT_EQ(sum.at(0), Tuple::Vector(1.f, 1.f, 0.f));
+  EXPECT_EQ(sum.at(1), Tuple::Vector(1.f, 0.f, 0.f));
+
+  // Inactive zero-length lanes are left alone instead of becoming NaN
+  auto zero = TupleBatch<float, 4>::Broadcast(Tuple::Vector(0.f, 0.f, 0.f));
+  zero.set(2, Tuple::Vector(0.f, 3.f, 4.f));
+  auto unit = zero.normalize(LaneMask<4>{false, false, true, false});
+  EXPECT_EQ(unit.at(0), Tuple::Vector(0.f, 0.f, 0.f));
+  EXPECT_EQ(unit.at(2), Tuple::Vector(0.f, 0.6f, 0.8f));
+
+  auto picked = Tuple::Select(mask, a, b);
+  EXPECT_EQ(picked.at(0), a.at(0));
+  EXPECT_EQ(picked.at(1), b.at(1));
+}
@@ -133,4 +133,41 @@ TEST_F(TupleTest, cross_product)
   auto a = Tuple::Vector(1, 2, 3);
   auto b = Tuple::Vector(2, 3, 4);
   EXPECT_EQ(Tuple::Vector(-1, 2, -1), a.cross(b));
-}
\ No newline at end of file
+}
+
+TEST_F(TupleTest, magnitude_includes_w)
+{
+  EXPECT_FLOAT_EQ(sqrt(15.), Tuple::Point(1., 2., 3.).magnitude());
+  EXPECT_FLOAT_EQ(sqrt(15.f), Tuple::Point(1.f, 2.f, 3.f).magnitude());
+}
+
+TEST_F(TupleTest, float_and_double_specializations_agree)
+{
+  // Tuple<float>/Tuple<double> may be SIMD specializations, both are held
+  // to the same hand-computed results.
+  auto runTest = []<typename T>(T)
+  {
+    auto a = Tuple::Tuple<T>(1, -2, 3, 1);
+    auto b = Tuple::Tuple<T>(-4, 5, 6, 0);
+    EXPECT_FLOAT_EQ(a.x(), 1);
+    EXPECT_FLOAT_EQ(a.y(), -2);
+    EXPECT_FLOAT_EQ(a.z(), 3);
+    EXPECT_FLOAT_EQ(a.w(), 1);
+    EXPECT_EQ(a + b, Tuple::Tuple<T>(-3, 3, 9, 1));
+    EXPECT_EQ(a - b, Tuple::Tuple<T>(5, -7, -3, 1));
+    EXPECT_EQ(-a, Tuple::Tuple<T>(-1, 2, -3, -1));
+    EXPECT_EQ(a * 2, Tuple::Tuple<T>(2, -4, 6, 2));
+    EXPECT_EQ(static_cast<T>(2) * a, Tuple::Tuple<T>(2, -4, 6, 2));
+    EXPECT_EQ(a / 2, Tuple::Tuple<T>(0.5, -1, 1.5, 0.5));
+    EXPECT_FLOAT_EQ(a.dot(b), 4);
+    auto v = Tuple::Tuple<T>(1, 2, 3, 0);
+    EXPECT_EQ(v.cross(Tuple::Tuple<T>(2, 3, 4, 0)), Tuple::Tuple<T>(-1, 2, -1, 0));
+    EXPECT_TRUE(v.cross(Tuple::Tuple<T>(2, 3, 4, 0)).IsVector());
+    EXPECT_EQ(v.normalize(), Tuple::Tuple<T>(1 / sqrt(14), 2 / sqrt(14), 3 / sqrt(14), 0));
+    EXPECT_FLOAT_EQ(v.normalize().magnitude(), 1);
+    EXPECT_NE(a, b);
+    EXPECT_EQ(Matrix::Matrix<T>(a), Matrix::Matrix<T>({{1}, {-2}, {3}, {1}}));
+  };
+  runTest(0.0f);
+  runTest(0.0);
+}